@@ -0,0 +1,284 @@
+/**
+  ******************************************************************************
+  * @file    pattern_engine.h
+  * @brief   Keyframe pattern interpreter.
+  *
+  *          A pattern is a const table of keyframes (LED mask, brightness and
+  *          duration) played by one generic player. The engine has no
+  *          hardware dependency: it only turns time into a (mask, level)
+  *          output that the caller applies to the LEDs.
+  *
+  *          Playback follows an absolute timeline: the frame shown at tick t
+  *          is the one at (t - origin) mod cycle, so late updates never
+  *          accumulate drift. Random jitter is the one exception; it moves
+  *          the origin forward by the extra time drawn.
+  ******************************************************************************
+  */
+#ifndef PATTERN_ENGINE_H
+#define PATTERN_ENGINE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "prng.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+#define PATTERN_LEVEL_FULL       255U  /*!< Keyframe level of a plain ON frame */
+#define PATTERN_RAMP_STEP_MS      20U  /*!< Output update period inside a ramp */
+
+/* Keyframe flags */
+#define PATTERN_KF_RAMP          0x01U /*!< Level ramps to the next keyframe's level */
+#define PATTERN_KF_RANDOM        0x02U /*!< Light 1..PICK random LEDs out of mask */
+#define PATTERN_KF_PICK_Pos      4U
+#define PATTERN_KF_PICK_Msk      (0xFU << PATTERN_KF_PICK_Pos)
+#define PATTERN_KF_PICK(n)       ((uint8_t)(((n) << PATTERN_KF_PICK_Pos) & PATTERN_KF_PICK_Msk))
+
+#define PATTERN_JITTER_UNIT_MS    10U  /*!< Resolution of pattern_keyframe_t.jitter */
+
+#define PATTERN_SPEED_NORMAL     100U  /*!< Player speed (percent) of authored timing */
+#define PATTERN_STREAM_MAX_FRAMES  8U  /*!< Longest program the DMA stream plays */
+
+#define PATTERN_LEVEL_LANES        4U  /*!< LEDs per packed level vector */
+#define PATTERN_BLEND_ONE        256U  /*!< pattern_blend() weight of "fully to" */
+
+/* Packed program image, as written by tools/patternc */
+#define PATTERN_BLOB_MAGIC       0x464B504CUL  /*!< "LPKF" little-endian */
+#define PATTERN_BLOB_VERSION     1U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  One step of a pattern (6 bytes, stored in flash).
+  */
+typedef struct {
+    uint16_t duration_ms;   /*!< Time the frame is shown, 0 = hold forever */
+    uint8_t mask;           /*!< LEDs lit (bit0 GREEN .. bit3 BLUE) */
+    uint8_t level;          /*!< Brightness of the lit LEDs, 0..255 */
+    uint8_t flags;          /*!< PATTERN_KF_* */
+    uint8_t jitter;         /*!< Random extra duration, PATTERN_JITTER_UNIT_MS units */
+} pattern_keyframe_t;
+
+/**
+  * @brief  A looping sequence of keyframes.
+  */
+typedef struct {
+    const pattern_keyframe_t *frames;   /*!< Keyframe table */
+    uint8_t frame_count;                /*!< Number of keyframes (>= 1) */
+} pattern_program_t;
+
+/**
+  * @brief  Header of a packed program image; the keyframes follow it.
+  */
+typedef struct {
+    uint32_t magic;                     /*!< PATTERN_BLOB_MAGIC */
+    uint8_t version;                    /*!< PATTERN_BLOB_VERSION */
+    uint8_t frame_count;                /*!< Keyframes after the header */
+    uint16_t reserved;                  /*!< 0 */
+} pattern_blob_header_t;
+
+/**
+  * @brief  Playback state of one program.
+  * @note   Players are independent, so several programs can run at once.
+  */
+typedef struct {
+    const pattern_program_t *program;   /*!< Program being played, NULL if idle */
+    uint32_t origin_ms;                 /*!< Tick at which phase 0 of the timeline lies */
+    uint32_t cycle_ms;                  /*!< Nominal cycle length at speed (up to the hold if one-shot) */
+    uint32_t frame_start_ms;            /*!< Tick the current frame started */
+    uint32_t next_ms;                   /*!< Tick the output next needs updating */
+    uint32_t frame_ms;                  /*!< Current frame length, jitter applied */
+    prng_t rng;                         /*!< Random picks and jitter of this player */
+    uint16_t speed;                     /*!< Playback rate, percent of authored timing */
+    uint8_t index;                      /*!< Current keyframe */
+    uint8_t mask;                       /*!< Output: LEDs lit */
+    uint8_t level;                      /*!< Output: brightness of the lit LEDs */
+    bool located;                       /*!< index / frame_start_ms match the timeline */
+    bool fresh;                         /*!< Output not reported yet */
+} pattern_player_t;
+
+/* Exported macros -----------------------------------------------------------*/
+
+/**
+  * @brief  Keyframe initializer of a plain on/off frame.
+  */
+#define PATTERN_FRAME(ms, leds)  { (ms), (leds), PATTERN_LEVEL_FULL, 0, 0 }
+
+/**
+  * @brief  Program initializer from a keyframe array.
+  */
+#define PATTERN_PROGRAM(table)   { (table), (uint8_t)(sizeof(table) / sizeof((table)[0])) }
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start playing a program from its first keyframe.
+  * @param  player: Player state.
+  * @param  program: Program to play (flash-resident, must outlive playback).
+  * @param  now_ms: Current tick, becomes the timeline origin.
+  * @retval None
+  */
+void pattern_player_start(pattern_player_t *player, const pattern_program_t *program, uint32_t now_ms);
+
+/**
+  * @brief  Seed the random picks and jitter of a player.
+  * @note   The same seed replays the same random frames. An unseeded player
+  *         is seeded with a fixed default on start.
+  * @param  player: Player state.
+  * @param  seed: Seed value.
+  * @retval None
+  */
+void pattern_player_seed(pattern_player_t *player, uint32_t seed);
+
+/**
+  * @brief  Change how fast a player runs through its program.
+  * @note   Keyframe durations (and jitter) are divided by speed / 100. A
+  *         playing program keeps its place: the timeline is re-anchored so
+  *         the same point of the cycle shows at @p now_ms.
+  * @param  player: Player state.
+  * @param  speed: Percent of authored timing, 0 for PATTERN_SPEED_NORMAL.
+  * @param  now_ms: Current tick.
+  * @retval None
+  */
+void pattern_player_set_speed(pattern_player_t *player, uint16_t speed, uint32_t now_ms);
+
+/**
+  * @brief  Stop a player. Its output no longer changes.
+  * @param  player: Player state.
+  * @retval None
+  */
+void pattern_player_stop(pattern_player_t *player);
+
+/**
+  * @brief  Advance a player to the current time.
+  * @note   Constant time in the normal case: moves at most one keyframe per
+  *         call. A player that fell more than a frame behind (or was seeked)
+  *         looks its frame up on the timeline instead.
+  * @param  player: Player state.
+  * @param  now_ms: Current tick.
+  * @retval true if player->mask / player->level changed and must be applied.
+  */
+bool pattern_player_update(pattern_player_t *player, uint32_t now_ms);
+
+/**
+  * @brief  Shift a player's timeline, e.g. by the time spent paused.
+  * @note   The current frame and its phase are kept; the output is reported
+  *         again by the next update.
+  * @param  player: Player state.
+  * @param  delta_ms: Milliseconds to push every pending deadline back by.
+  * @retval None
+  */
+void pattern_player_shift(pattern_player_t *player, uint32_t delta_ms);
+
+/**
+  * @brief  Have the next update report the output even if unchanged.
+  * @param  player: Player state.
+  * @retval None
+  */
+void pattern_player_redraw(pattern_player_t *player);
+
+/**
+  * @brief  Move a player to a position in its cycle.
+  * @param  player: Player state.
+  * @param  phase_ms: Position to show at @p now_ms (wrapped to the cycle).
+  * @param  now_ms: Current tick.
+  * @retval None
+  */
+void pattern_player_seek(pattern_player_t *player, uint32_t phase_ms, uint32_t now_ms);
+
+/**
+  * @brief  Get a player's position in its cycle.
+  * @param  player: Player state.
+  * @param  now_ms: Tick to evaluate at.
+  * @retval Milliseconds since the start of the current cycle (one-shot
+  *         programs stop counting at their hold frame).
+  */
+uint32_t pattern_player_phase(const pattern_player_t *player, uint32_t now_ms);
+
+/**
+  * @brief  Get how long a keyframe lasts at a player's speed.
+  * @param  player: Player state (speed is used).
+  * @param  program: Program the keyframe belongs to.
+  * @param  index: Keyframe index.
+  * @retval Duration in ms without jitter, 0 for a hold frame.
+  */
+uint32_t pattern_player_frame_ms(const pattern_player_t *player, const pattern_program_t *program,
+                                 uint8_t index);
+
+/**
+  * @brief  Get the tick at which the player next needs an update.
+  * @param  player: Player state.
+  * @param  deadline_ms: Receives the absolute tick.
+  * @retval false if the output will not change again (idle or holding).
+  */
+bool pattern_player_next_deadline(const pattern_player_t *player, uint32_t *deadline_ms);
+
+/**
+  * @brief  Get a player's output as four packed 8-bit LED levels.
+  * @param  player: Player state.
+  * @retval Byte n holds the level of LED n (bit n of the mask), 0 if unlit.
+  */
+uint32_t pattern_player_levels(const pattern_player_t *player);
+
+/**
+  * @brief  Blend two packed level vectors.
+  * @note   Four LEDs for two 32-bit multiplies: even and odd bytes are
+  *         spread into 16-bit lanes (mask 0x00FF00FF) and weighted in place,
+  *         255 x 256 never carrying into the next lane.
+  * @param  from: Levels at weight 0.
+  * @param  to: Levels at weight PATTERN_BLEND_ONE.
+  * @param  weight: 0 .. PATTERN_BLEND_ONE.
+  * @retval Blended levels.
+  */
+uint32_t pattern_blend(uint32_t from, uint32_t to, uint32_t weight);
+
+/**
+  * @brief  Get the nominal length of one program cycle.
+  * @param  program: Program to measure.
+  * @retval Sum of keyframe durations without jitter; for a one-shot program
+  *         the time until its hold frame.
+  */
+uint32_t pattern_program_cycle_ms(const pattern_program_t *program);
+
+/**
+  * @brief  Find the keyframe shown at a position in the cycle.
+  * @param  program: Program to search.
+  * @param  offset_ms: Position in the cycle, without jitter.
+  * @param  frame_offset_ms: Receives the position the keyframe starts at.
+  * @retval Keyframe index.
+  */
+uint8_t pattern_program_frame_at(const pattern_program_t *program, uint32_t offset_ms,
+                                 uint32_t *frame_offset_ms);
+
+/**
+  * @brief  Check whether a program can be played as a fixed-rate on/off loop.
+  * @note   True when every keyframe has the same non-zero duration, full
+  *         level and no flags, i.e. when it needs no CPU between frames.
+  * @param  program: Program to check.
+  * @retval true if the program is a plain periodic mask sequence.
+  */
+bool pattern_program_is_periodic(const pattern_program_t *program);
+
+/**
+  * @brief  Check whether the firmware plays a program from the DMA stream.
+  * @note   Periodic and at most PATTERN_STREAM_MAX_FRAMES frames long; the
+  *         pattern manager and patternc share this test.
+  * @param  program: Program to check.
+  * @retval true if the program is streamed rather than interpreted.
+  */
+bool pattern_program_is_streamable(const pattern_program_t *program);
+
+/**
+  * @brief  Map a packed program image onto a program descriptor.
+  * @note   The keyframes are used in place, so @p blob must be 4-byte
+  *         aligned and stay valid while the program plays.
+  * @param  blob: Image produced by tools/patternc.
+  * @param  size: Image size in bytes.
+  * @param  program: Receives the program.
+  * @retval false if the image is malformed or of another version.
+  */
+bool pattern_program_from_blob(const void *blob, uint32_t size, pattern_program_t *program);
+
+#endif /* PATTERN_ENGINE_H */
+
+/******************************** END OF FILE *********************************/
@@ -12,6 +12,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stdbool.h>
 #include <stdint.h>
+#include "pattern_engine.h"
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -25,7 +26,7 @@ typedef enum {
     PATTERN_CHASE_CLOCKWISE,    /*!< Chase pattern clockwise */
     PATTERN_CHASE_ANTICLOCKWISE,/*!< Chase pattern anti-clockwise */
     PATTERN_KNIGHT_RIDER,       /*!< Knight Rider scanner effect */
-    PATTERN_BREATHE,            /*!< Breathing effect (simulated PWM) */
+    PATTERN_BREATHE,            /*!< Breathing effect (TIM4 PWM) */
     PATTERN_RAINBOW,            /*!< Color cycle (uses all LEDs) */
     PATTERN_RANDOM_TWINKLE,     /*!< Random LED twinkling */
     PATTERN_COUNT               /*!< Total number of patterns */
@@ -40,6 +41,26 @@ typedef enum {
     PATTERN_STATE_PAUSED        /*!< Pattern paused */
 } pattern_state_t;
 
+/**
+  * @brief  Everything needed to continue a pattern later on the same frame.
+  * @note   The player holds the keyframe index, timeline and random state,
+  *         which is also what gives breathe and knight-rider their direction.
+  */
+typedef struct {
+    pattern_t pattern;          /*!< Pattern shown */
+    pattern_state_t state;      /*!< Running, paused or stopped */
+    uint16_t speed;             /*!< Playback speed in percent */
+    uint32_t taken_ms;          /*!< Tick the timeline was frozen at */
+    pattern_player_t player;    /*!< Player state at taken_ms */
+} pattern_snapshot_t;
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+  * @brief  Deadline distance reported when no frame is scheduled.
+  */
+#define PATTERN_IDLE_HORIZON_MS   1000U
+
 /* Exported functions --------------------------------------------------------*/
 
 /**
@@ -55,6 +76,63 @@ void pattern_manager_init(void);
   */
 void pattern_manager_set_pattern(pattern_t pattern);
 
+/**
+  * @brief  Set a pattern and the speed to play it at.
+  * @note   Same as pattern_manager_set_speed() then
+  *         pattern_manager_set_pattern(), but the pattern starts only once.
+  * @param  pattern: Pattern to set.
+  * @param  speed: Percent of authored timing, 0 for normal.
+  * @param  start_ms: Tick its cycle starts at; a tick in the past starts it
+  *         that far into the cycle.
+  * @retval None
+  */
+void pattern_manager_play(pattern_t pattern, uint16_t speed, uint32_t start_ms);
+
+/**
+  * @brief  Prepare a pattern ahead of switching to it.
+  * @note   Builds its DMA stream words now, so a later switch to it only
+  *         has to start the stream. One pattern is held; a new cue
+  *         replaces it.
+  * @param  pattern: Pattern that will be set.
+  * @param  speed: Speed it will play at, 0 for normal.
+  * @retval Its cycle length at that speed, as pattern_manager_get_cycle_ms().
+  */
+uint32_t pattern_manager_cue(pattern_t pattern, uint16_t speed);
+
+/**
+  * @brief  Set the crossfade used when switching patterns.
+  * @note   While fading, both patterns are rendered and blended per LED,
+  *         so they run on PWM brightness even if normally DMA-streamed.
+  * @param  duration_ms: Fade length, 0 to cut straight to the new pattern.
+  * @retval None
+  */
+void pattern_manager_set_transition(uint16_t duration_ms);
+
+/**
+  * @brief  Set the playback speed of patterns.
+  * @note   Applies to the current pattern at once (keeping its place in the
+  *         cycle) and to every pattern started later.
+  * @param  speed: Percent of authored timing (PATTERN_SPEED_NORMAL = 100),
+  *         0 for normal.
+  * @retval None
+  */
+void pattern_manager_set_speed(uint16_t speed);
+
+/**
+  * @brief  Get the playback speed of patterns.
+  * @retval Percent of authored timing.
+  */
+uint16_t pattern_manager_get_speed(void);
+
+/**
+  * @brief  Seed pattern randomness with a fixed value.
+  * @note   Each start of a pattern then replays the same random frames,
+  *         also when RNG_HW_ENABLED would otherwise seed from hardware.
+  * @param  seed: Seed value.
+  * @retval None
+  */
+void pattern_manager_set_seed(uint32_t seed);
+
 /**
   * @brief  Get current pattern.
   * @retval Current pattern.
@@ -104,11 +182,83 @@ void pattern_manager_pause(void);
 void pattern_manager_resume(void);
 
 /**
-  * @brief  Update pattern (call in main loop).
-  * @note   Handles timing and LED updates for current pattern.
+  * @brief  Jump to a position in the current pattern's cycle.
+  * @note   The frame shown is a pure function of the pattern, its start tick
+  *         and the time, so boards sharing a tick base can phase-align with
+  *         pattern_manager_seek(systick_get_ticks()). Streamed patterns
+  *         restart partway into the frame the position falls in.
+  * @param  phase_ms: Position in the cycle, wrapped to its length.
   * @retval None
   */
-void pattern_manager_update(void);
+void pattern_manager_seek(uint32_t phase_ms);
+
+/**
+  * @brief  Get the position in the current pattern's cycle.
+  * @retval Milliseconds since the current cycle started (frozen while paused).
+  */
+uint32_t pattern_manager_get_phase(void);
+
+/**
+  * @brief  Get the length of one cycle of the current pattern.
+  * @retval Cycle length in ms at the current speed, without random jitter;
+  *         0 for a static pattern.
+  */
+uint32_t pattern_manager_get_cycle_ms(void);
+
+/**
+  * @brief  Capture the pattern state.
+  * @note   A crossfade in progress is settled on the new pattern first.
+  * @param  snapshot: Receives the state.
+  * @retval None
+  */
+void pattern_manager_snapshot(pattern_snapshot_t *snapshot);
+
+/**
+  * @brief  Continue from a captured state.
+  * @note   Time between the snapshot and now is skipped: a running pattern
+  *         is drawn at once on the frame and phase it was captured on.
+  * @param  snapshot: State from pattern_manager_snapshot().
+  * @retval None
+  */
+void pattern_manager_restore(const pattern_snapshot_t *snapshot);
+
+/**
+  * @brief  Start an action that may have to be undone.
+  * @note   Captures the state; pause, resume, next and the like may then be
+  *         applied right away and either kept or rolled back.
+  * @retval None
+  */
+void pattern_manager_provisional_begin(void);
+
+/**
+  * @brief  Check for a provisional action awaiting commit or rollback.
+  * @retval true if pattern_manager_provisional_begin() is still open.
+  */
+bool pattern_manager_provisional_pending(void);
+
+/**
+  * @brief  Keep what was done since pattern_manager_provisional_begin().
+  * @retval None
+  */
+void pattern_manager_provisional_commit(void);
+
+/**
+  * @brief  Undo what was done since pattern_manager_provisional_begin().
+  * @note   A pattern that was running continues where it would be had it
+  *         never been touched.
+  * @retval true if there was something to undo.
+  */
+bool pattern_manager_provisional_rollback(void);
+
+/**
+  * @brief  Update pattern (call in main loop).
+  * @note   Handles timing and LED updates for current pattern. Nothing needs
+  *         to happen before the returned tick, so the caller may sleep until
+  *         then; while stopped, paused, streaming or holding a frame it is
+  *         PATTERN_IDLE_HORIZON_MS away.
+  * @retval Absolute tick of the next required call.
+  */
+uint32_t pattern_manager_update(void);
 
 
 
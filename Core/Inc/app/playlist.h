@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    playlist.h
+  * @brief   Pattern playlist sequencer.
+  *
+  *          Plays a const table of (pattern, duration, speed, repeat) entries
+  *          through the pattern manager, switching at absolute deadlines so
+  *          entry lengths never drift with main loop latency.
+  ******************************************************************************
+  */
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "pattern_manager.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  One playlist step (stored in flash).
+  */
+typedef struct {
+    pattern_t pattern;          /*!< Pattern to show */
+    uint32_t duration_ms;       /*!< Length of one play, 0 = one pattern cycle */
+    uint16_t speed;             /*!< Percent of authored timing, 0 = normal */
+    uint8_t repeat;             /*!< Plays before moving on, 0 = once */
+} playlist_entry_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start playing a playlist from its first entry.
+  * @param  entries: Entry table (must outlive playback).
+  * @param  count: Number of entries.
+  * @param  loop: Start over after the last entry instead of stopping on it.
+  * @retval None
+  */
+void playlist_start(const playlist_entry_t *entries, uint8_t count, bool loop);
+
+/**
+  * @brief  Stop advancing. The current pattern keeps running, at the speed
+  *         it had before playlist_start().
+  * @retval None
+  */
+void playlist_stop(void);
+
+/**
+  * @brief  Skip to the next entry now, dropping remaining repeats.
+  * @retval None
+  */
+void playlist_next(void);
+
+/**
+  * @brief  Check whether a playlist is playing.
+  * @retval true if entries are still being advanced.
+  */
+bool playlist_is_active(void);
+
+/**
+  * @brief  Get the entry being played.
+  * @retval Index into the entry table.
+  */
+uint8_t playlist_get_index(void);
+
+/**
+  * @brief  Advance the playlist (call in main loop, before
+  *         pattern_manager_update()).
+  * @note   Entries with a static pattern and no duration stay until
+  *         playlist_next(). Time spent with the pattern paused or stopped
+  *         does not count towards an entry.
+  * @retval Absolute tick of the next required call.
+  */
+uint32_t playlist_update(void);
+
+#endif /* PLAYLIST_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    prng.h
+  * @brief   Small seedable pseudo-random number generator (xorshift32).
+  ******************************************************************************
+  */
+#ifndef PRNG_H
+#define PRNG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Generator state. Each user keeps its own, so sequences are
+  *         independent and replay exactly from the same seed.
+  */
+typedef struct {
+    uint32_t state;             /*!< Never 0 once seeded */
+} prng_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Seed a generator.
+  * @param  rng: Generator state.
+  * @param  seed: Any value; 0 is remapped since xorshift would stick there.
+  * @retval None
+  */
+void prng_seed(prng_t *rng, uint32_t seed);
+
+/**
+  * @brief  Draw the next 32-bit value.
+  * @param  rng: Generator state.
+  * @retval Pseudo-random value.
+  */
+uint32_t prng_next(prng_t *rng);
+
+/**
+  * @brief  Draw a value in [0, n).
+  * @note   Multiply-shift instead of modulo: one UMULL, no division.
+  * @param  rng: Generator state.
+  * @param  n: Range size; 0 returns 0.
+  * @retval Pseudo-random value below @p n.
+  */
+uint32_t prng_range(prng_t *rng, uint32_t n);
+
+#endif /* PRNG_H */
+
+/******************************** END OF FILE *********************************/
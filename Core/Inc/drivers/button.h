@@ -11,6 +11,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stdbool.h>
 #include <stdint.h>
+#include "board_config.h"
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -22,14 +23,56 @@ typedef enum {
     BUTTON_EVENT_PRESSED,     /*!< Button pressed (short) */
     BUTTON_EVENT_RELEASED,    /*!< Button released */
     BUTTON_EVENT_LONG_PRESS,  /*!< Long press (2 seconds) */
-    BUTTON_EVENT_DOUBLE_CLICK /*!< Double click detected */
+    BUTTON_EVENT_DOUBLE_CLICK,/*!< Double click detected */
+    BUTTON_EVENT_MULTI_CLICK, /*!< Third or later click of a run, count = clicks */
+    BUTTON_EVENT_REPEAT,      /*!< Auto-repeat while held, count = repeats */
+    BUTTON_EVENT_CLICK_HOLD,  /*!< Hold after clicks, count = clicks before */
+    BUTTON_EVENT_CHORD,       /*!< Chord held, count = BUTTON_CHORD_TABLE index */
+    BUTTON_EVENT_PRESS_PROVISIONAL, /*!< First edge of a press, not yet debounced */
+    BUTTON_EVENT_PRESS_RETRACTED    /*!< Provisional press was a glitch, undo it */
 } button_event_t;
 
+/**
+  * @brief  Bit of a button in a button mask.
+  */
+#define BUTTON_MASK(button)   (1UL << (button))
+
+/**
+  * @brief  Index of the lowest set bit of a non-zero button (or pin) mask.
+  */
+#define BUTTON_LOWEST_BIT(mask) ((uint8_t)(31U - __CLZ((mask) & (0U - (mask)))))
+
+/**
+  * @brief  One queued button event.
+  */
+typedef struct {
+    uint32_t timestamp_us;    /*!< Button clock (see button_now_us()) at the event */
+    uint8_t event;            /*!< button_event_t */
+    uint8_t button;           /*!< button_id_t (first button of a chord) */
+    uint8_t count;            /*!< Event-specific count, see button_event_t */
+} button_event_record_t;
+
+/**
+  * @brief  Debounce figures of one button.
+  */
+typedef struct {
+    uint32_t window_us;       /*!< Current debounce window */
+    uint32_t bounce_us;       /*!< Learned bounce envelope, 0 if not measured */
+    uint32_t last_bounce_us;  /*!< Bounce of the latest edge */
+    uint32_t samples;         /*!< Edges measured */
+} button_debounce_t;
+
 /* Exported functions --------------------------------------------------------*/
 
 /**
   * @brief  Initialize button GPIO and EXTI interrupt.
-  * @note   Must be called after systick_init().
+  * @note   Must be called after systick_init(). Buttons come from
+  *         BUTTON_DESCRIPTOR_TABLE. Unless the capture backend times it,
+  *         PA0 is also registered with the EXTI dispatcher: with
+  *         BUTTON_EAGER_ENABLED a press edge queues
+  *         BUTTON_EVENT_PRESS_PROVISIONAL at once, which the debounced
+  *         BUTTON_EVENT_PRESSED confirms or BUTTON_EVENT_PRESS_RETRACTED
+  *         undoes within BUTTON_EAGER_CONFIRM_MS.
   * @retval None
   */
 void button_init(void);
@@ -46,26 +89,86 @@ bool button_is_pressed_raw(void);
   */
 bool button_is_pressed(void);
 
+/**
+  * @brief  Check whether the application has no button work waiting.
+  * @note   Debouncing and gesture timing run from button_tick(), so the
+  *         main loop may sleep whenever this is true.
+  * @retval true if no event is queued.
+  */
+bool button_is_idle(void);
+
 /**
   * @brief  Get button event (non-blocking).
-  * @note   Call periodically in main loop.
+  * @note   Call periodically in main loop. Takes the oldest queued event.
   * @retval button_event_t Detected event.
   */
 button_event_t button_get_event(void);
 
 /**
-  * @brief  Update button state machine (non-blocking).
-  * @note   Call periodically (e.g., every 10ms) in main loop.
+  * @brief  Take up to @p max queued events, oldest first (non-blocking).
+  * @note   Single consumer: call from one context only. Interrupts stay
+  *         enabled; the queue is lock-free.
+  * @param  records: Receives the events.
+  * @param  max: Capacity of @p records.
+  * @retval Number of events written.
+  */
+uint8_t button_read_events(button_event_record_t *records, uint8_t max);
+
+/**
+  * @brief  Get how many events were dropped because the queue was full.
+  * @retval Events lost since button_init().
+  */
+uint32_t button_get_dropped_events(void);
+
+/**
+  * @brief  Scan and debounce all buttons, run gesture timing (see gesture.h).
+  * @note   Call from SysTick_Handler() every ms. Every BUTTON_SCAN_PERIOD_MS
+  *         each button port is read once and debounced as a whole, so the
+  *         cost does not grow with the number of buttons on a port.
+  * @retval None
+  */
+void button_tick(void);
+
+/**
+  * @brief  Get the clock that button events and gesture timing use.
+  * @note   1 us resolution with the capture backend, 1 ms (in us units)
+  *         with the port scan. Wraps every ~71 minutes either way.
+  * @retval Microseconds.
+  */
+uint32_t button_now_us(void);
+
+/**
+  * @brief  Report a debounced edge from a button backend.
+  * @note   Backend interface, called from the scan tick, the capture
+  *         interrupt or the one-shot settle timer; all run at SysTick
+  *         priority so never preempt each other.
+  * @param  button: Button that changed.
+  * @param  pressed: New level.
+  * @param  time_us: When it changed, on the button_now_us() clock.
+  * @retval None
+  */
+void button_edge(button_id_t button, bool pressed, uint32_t time_us);
+
+/**
+  * @brief  Get the debounce window of a button and what was learned for it.
+  * @note   Bounce is measured by the capture backend, which adapts its
+  *         lockout to it (BUTTON_CAPTURE_ADAPTIVE); the scan and one-shot
+  *         backends report their fixed window.
+  * @param  button: Button.
+  * @param  info: Receives the figures.
   * @retval None
   */
-void button_update(void);
+void button_get_debounce(button_id_t button, button_debounce_t *info);
 
 /**
-  * @brief  EXTI interrupt handler for button.
-  * @note   Call from EXTI0_IRQHandler().
+  * @brief  Keep the current press of a button away from the gestures.
+  * @note   For a press that already served a purpose, such as waking the
+  *         board. The press and its release are swallowed; if the press
+  *         is too short to be debounced it is forgotten after a while.
+  * @param  button: Button.
   * @retval None
   */
-void button_exti_handler(void);
+void button_suppress(button_id_t button);
 
 
 
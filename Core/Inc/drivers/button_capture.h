@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    button_capture.h
+  * @brief   Input-capture backend for the user button (TIM5_CH1 on PA0).
+  *
+  *          Press and release edges are captured on separate channels of a
+  *          free-running 1 MHz 32-bit counter, so press timing has
+  *          microsecond resolution and the direction of an edge is known
+  *          from the capture. The input filter rejects glitches before they
+  *          reach the captures; contact bounce is absorbed by a lockout
+  *          after each reported edge, sized from the bounce measured on
+  *          earlier edges.
+  ******************************************************************************
+  */
+#ifndef BUTTON_CAPTURE_H
+#define BUTTON_CAPTURE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "button.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Switch PA0 to TIM5_CH1 and start capturing press and release edges.
+  * @note   Called by button_init() when BUTTON_CAPTURE_ENABLED.
+  * @retval None
+  */
+void button_capture_init(void);
+
+/**
+  * @brief  Get the capture timebase.
+  * @retval Free-running microsecond counter (wraps every ~71 minutes).
+  */
+uint32_t button_capture_now_us(void);
+
+/**
+  * @brief  Get the current lockout and the learned bounce envelope.
+  * @param  info: Receives the figures.
+  * @retval None
+  */
+void button_capture_get_debounce(button_debounce_t *info);
+
+/**
+  * @brief  Capture / lockout interrupt handler.
+  * @note   Call from TIM5_IRQHandler(). Reports edges via button_edge().
+  * @retval None
+  */
+void button_capture_handler(void);
+
+#endif /* BUTTON_CAPTURE_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    button_oneshot.h
+  * @brief   EXTI + one-shot timer backend for the user button (PA0).
+  *
+  *          The first EXTI edge masks the line and starts a one-shot basic
+  *          timer. When it expires the pin is sampled once, a change is
+  *          reported and the line is unmasked again. Nothing runs while the
+  *          button is untouched, and a bouncing contact costs one EXTI and
+  *          one timer interrupt per settle, however long it bounces.
+  ******************************************************************************
+  */
+#ifndef BUTTON_ONESHOT_H
+#define BUTTON_ONESHOT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure the settle timer and take the current pin level.
+  * @note   Called by button_init() when BUTTON_ONESHOT_ENABLED, after EXTI0
+  *         is set up.
+  * @retval None
+  */
+void button_oneshot_init(void);
+
+/**
+  * @brief  Start a settle window for a new edge.
+  * @note   Called from the button EXTI callback. The dispatcher masked
+  *         EXTI0 when the edge fired (see exti_set_oneshot()); it stays
+  *         masked until the window ends.
+  * @retval None
+  */
+void button_oneshot_edge(void);
+
+/**
+  * @brief  Settle timer interrupt handler.
+  * @note   Call from TIM6_DAC_IRQHandler(). Reports edges via button_edge().
+  * @retval None
+  */
+void button_oneshot_handler(void);
+
+#endif /* BUTTON_ONESHOT_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    button_scan.h
+  * @brief   Vertical-counter debouncer for up to 32 inputs in parallel.
+  *
+  *          Each bit lane of a 32-bit word is one input with its own 2-bit
+  *          counter, stored "vertically" as one bit in cnt0 and one in cnt1.
+  *          A lane flips its debounced state after four consecutive samples
+  *          disagreeing with it; a single agreeing sample resets its count.
+  *          One step is a handful of logic ops for all lanes together.
+  ******************************************************************************
+  */
+#ifndef BUTTON_SCAN_H
+#define BUTTON_SCAN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define BUTTON_SCAN_SAMPLES      4U    /*!< Stable samples before a lane flips */
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Debouncer state of one 32-lane word.
+  */
+typedef struct {
+    uint32_t cnt0;          /*!< Counter bit 0 of every lane */
+    uint32_t cnt1;          /*!< Counter bit 1 of every lane */
+    uint32_t state;         /*!< Debounced level of every lane */
+} button_scan_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set the debounced state without reporting edges.
+  * @param  scan: Debouncer state.
+  * @param  state: Level of every lane.
+  * @retval None
+  */
+void button_scan_reset(button_scan_t *scan, uint32_t state);
+
+/**
+  * @brief  Feed one sample of every lane.
+  * @param  scan: Debouncer state.
+  * @param  sample: Raw level of every lane.
+  * @retval Lanes whose debounced state flipped; rising ones are set in
+  *         scan->state, falling ones clear.
+  */
+uint32_t button_scan_step(button_scan_t *scan, uint32_t sample);
+
+#endif /* BUTTON_SCAN_H */
+
+/******************************** END OF FILE *********************************/
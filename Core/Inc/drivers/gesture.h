@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file    gesture.h
+  * @brief   Table-driven button gesture recognizer.
+  *
+  *          Turns debounced press/release edges into click runs, holds,
+  *          hold-after-click, auto-repeat and chords. Every button runs the
+  *          same small transition table with its own button_profile_t; an
+  *          edge costs one table lookup, and timeouts are kept as deadlines
+  *          so a tick with nothing due costs a single compare.
+  ******************************************************************************
+  */
+#ifndef GESTURE_H
+#define GESTURE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "button.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Receiver of recognized gestures.
+  * @param  button: Button (first button of a chord).
+  * @param  event: Gesture.
+  * @param  count: Clicks, repeats or chord index, see button_event_t.
+  * @param  time_us: Button clock at the gesture.
+  */
+typedef void (*gesture_emit_t)(button_id_t button, button_event_t event, uint8_t count, uint32_t time_us);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Reset every button to idle.
+  * @param  emit: Called for each recognized gesture.
+  * @retval None
+  */
+void gesture_init(gesture_emit_t emit);
+
+/**
+  * @brief  Feed one debounced edge.
+  * @param  button: Button that changed.
+  * @param  pressed: New level.
+  * @param  now_us: Button clock at the edge.
+  * @retval None
+  */
+void gesture_edge(button_id_t button, bool pressed, uint32_t now_us);
+
+/**
+  * @brief  Fire the hold, repeat and click-gap timeouts that are due.
+  * @param  now_us: Button clock.
+  * @retval None
+  */
+void gesture_tick(uint32_t now_us);
+
+#endif /* GESTURE_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file    hw_rng.h
+  * @brief   STM32F4 hardware random number generator driver.
+  ******************************************************************************
+  */
+#ifndef HW_RNG_H
+#define HW_RNG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Enable the RNG peripheral.
+  * @note   The RNG needs PLL48CLK; without it hw_rng_read() times out.
+  * @retval None
+  */
+void hw_rng_init(void);
+
+/**
+  * @brief  Read one 32-bit random word.
+  * @note   Polls DRDY at most RNG_HW_TIMEOUT_POLLS times. A seed or clock
+  *         error discards the word and restarts the generator.
+  * @param  value: Receives the word.
+  * @retval true on success, false on timeout or error.
+  */
+bool hw_rng_read(uint32_t *value);
+
+#endif /* HW_RNG_H */
+
+/******************************** END OF FILE *********************************/
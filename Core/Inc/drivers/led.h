@@ -9,18 +9,49 @@
 
 
 
+#if (LED_PWM_RESOLUTION_BITS < 8U) || (LED_PWM_RESOLUTION_BITS > 16U)
+#error "LED_PWM_RESOLUTION_BITS must be between 8 and 16"
+#endif
+
+// Bit set of LEDs, bit n = led_id_t n (LED_COUNT <= 32)
+typedef uint32_t led_mask_t;
+
+#define LED_MASK(led)   ((led_mask_t)1U << (led))
+#define LED_MASK_ALL    ((led_mask_t)((1ULL << LED_COUNT) - 1U))
+
+// Full-scale value accepted by led_set_brightness()
+#define LED_BRIGHTNESS_MAX   ((uint16_t)((1UL << LED_PWM_RESOLUTION_BITS) - 1U))
+
+// Step period of led_knight_rider()
+#define LED_KNIGHT_RIDER_STEP_MS   200U
+
 // Remove all timing structures - keep it simple!
 typedef struct {
-    uint32_t last_toggle_ms; // Last toggle time (from systick)
+    uint32_t next_toggle_ms; // Absolute tick of the next toggle (heap key)
     uint32_t on_time_ms;
     uint32_t off_time_ms;
     bool is_on;
     bool is_blinking;
 } led_blink_ctrl_t;
 
+/**
+ * @brief LED frame under construction
+ * @note Collects the changes for a whole frame so they reach each port in
+ *       one atomic BSRR write. Caller-owned; build it on the stack.
+ */
+typedef struct {
+    uint32_t bsrr[LED_PORT_COUNT];  // Set (low half) / reset (high half) per port
+    led_mask_t touched;             // LEDs staged in this frame
+    led_mask_t on;                  // Staged LEDs that end up ON
+} led_frame_t;
+
 //================================
 // Basic LED functions
 //================================
+// On/off, toggle, frame and brightness calls are interrupt-safe: pins are
+// only written through BSRR (or bit-band for MODER) and the logical state
+// lives in a RAM shadow updated with LDREX/STREX, so ISRs may drive LEDs
+// without disabling interrupts. Blink and pattern helpers are main-loop only.
 
 /**
  * @brief Initialize LED GPIO pin
@@ -57,9 +88,34 @@ void led_set(led_id_t led, bool state);
  * @brief Get LED state
  * @param led LED identifier
  * @return true if ON, false if OFF
+ * @note Reads the RAM shadow, not ODR. Frames played by led_stream bypass
+ *       the shadow while the stream runs.
  */
 bool led_is_on(led_id_t led);
 
+//=============================
+// Brightness (PWM) functions
+//=============================
+
+/**
+ * @brief Set LED brightness using hardware PWM
+ * @param led LED identifier or LED_ALL
+ * @param level Duty from 0 (off) to LED_BRIGHTNESS_MAX (fully on)
+ * @note Routes the pin to its LED_PWM_TIMER channel; the duty is then
+ *       generated in hardware. Any on/off call on the LED returns it to
+ *       GPIO mode. LEDs without a channel are driven by the BCM timer at
+ *       8-bit resolution (main context only), or switched on above half
+ *       scale when LED_BCM_ENABLED is 0.
+ */
+void led_set_brightness(led_id_t led, uint16_t level);
+
+/**
+ * @brief Get LED brightness
+ * @param led LED identifier
+ * @return Current PWM or BCM level, or 0 / LED_BRIGHTNESS_MAX in GPIO mode
+ */
+uint16_t led_get_brightness(led_id_t led);
+
 //=============================
 // Multi-LED functions
 //=============================
@@ -79,12 +135,81 @@ void led_all_off(void);
  */
 void led_all_toggle(void);
 
+//============================
+// Frame functions
+//============================
+
+/**
+ * @brief Start an empty frame (no LED changes staged)
+ * @param frame Frame to initialize
+ */
+void led_frame_begin(led_frame_t *frame);
+
+/**
+ * @brief Stage an LED state in the frame
+ * @param frame Frame being built
+ * @param led LED identifier or LED_ALL
+ * @param state true = ON, false = OFF
+ * @note Later stages of the same LED replace earlier ones
+ */
+void led_frame_stage(led_frame_t *frame, led_id_t led, bool state);
+
+/**
+ * @brief Stage several LEDs at once
+ * @param frame Frame being built
+ * @param leds LEDs to stage
+ * @param on Subset of @p leds to turn ON; the rest are turned OFF
+ */
+void led_frame_stage_mask(led_frame_t *frame, led_mask_t leds, led_mask_t on);
+
+/**
+ * @brief Stage all LEDs from a pattern
+ * @param frame Frame being built
+ * @param pattern 4-bit pattern (bit0: GREEN, bit1: ORANGE, bit2: RED, bit3: BLUE)
+ */
+void led_frame_stage_pattern(led_frame_t *frame, uint8_t pattern);
+
+/**
+ * @brief Apply every staged change with a single BSRR write per port
+ * @param frame Frame to commit
+ * @note LEDs not staged keep their current state
+ */
+void led_frame_commit(const led_frame_t *frame);
+
+/**
+ * @brief Set every LED at once (one write per port)
+ * @param on LEDs to turn ON; all others are turned OFF
+ */
+void led_set_mask(led_mask_t on);
+
+/**
+ * @brief Get the board descriptor of an LED
+ * @param led LED identifier
+ * @return Descriptor from LED_DESCRIPTOR_TABLE, or NULL if out of range
+ */
+const led_desc_t *led_get_desc(led_id_t led);
+
+/**
+ * @brief Get the GPIO registers of an LED port
+ * @param port Index into LED_PORT_TABLE
+ * @return Port registers, or NULL if out of range
+ */
+GPIO_TypeDef *led_get_port(uint8_t port);
+
+/**
+ * @brief Build the BSRR word that shows a mask on one port
+ * @param port Index into LED_PORT_TABLE
+ * @param on LEDs to turn ON; other LEDs of that port are turned OFF
+ * @return BSRR word with polarity applied (LEDs on other ports ignored)
+ */
+uint32_t led_port_word(uint8_t port, led_mask_t on);
+
 //============================
 // Pattern functions
 //===========================
 
 /**
- * @brief Set all LEDs to specific pattern
+ * @brief Set all LEDs to specific pattern (one atomic write)
  * @param pattern 4-bit pattern (bit0: GREEN, bit1: ORANGE, bit2: RED, bit3: BLUE)
  */
 void led_set_pattern(uint8_t pattern);
@@ -92,11 +217,14 @@ void led_set_pattern(uint8_t pattern);
 /**
  * @brief Simple chase pattern (for testing)
  * @param delay_ms Time between steps (ms)
+ * @note Non-blocking: call from the main loop; each call advances at most
+ *       one step once delay_ms has elapsed since the previous one
  */
 void led_chase(uint32_t delay_ms);
 
 /**
  * @brief Knight Rider pattern
+ * @note Non-blocking like led_chase(), one step per LED_KNIGHT_RIDER_STEP_MS
  */
 void led_knight_rider(void);
 
@@ -121,9 +249,19 @@ void led_blink_stop(led_id_t led);
 
 /**
  * @brief Update all blinking LEDs (call in main loop)
+ * @note Only LEDs whose toggle is due are touched; the cost is independent
+ *       of how many LEDs blink while none is due.
  */
 void led_update_all(void);
 
+/**
+ * @brief Get the next blink toggle deadline
+ * @param deadline_ms Receives the absolute systick tick of the earliest toggle
+ * @return true if an LED is blinking, false if nothing is scheduled
+ * @note Lets the caller sleep until led_update_all() has work to do
+ */
+bool led_next_deadline(uint32_t *deadline_ms);
+
 
 
 
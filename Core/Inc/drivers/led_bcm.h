@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    led_bcm.h
+  * @brief   Binary code modulation brightness backend for GPIO LEDs.
+  ******************************************************************************
+  */
+#ifndef LED_BCM_H
+#define LED_BCM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "led.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Initialize the BCM timer.
+  * @note   Called by led_init(). The timer only runs while at least one
+  *         LED is driven by BCM.
+  * @retval None
+  */
+void led_bcm_init(void);
+
+/**
+  * @brief  Drive an LED with 8-bit BCM brightness.
+  * @note   Main context only. The new level takes effect at the next frame
+  *         boundary, so a frame never mixes old and new bit planes.
+  * @param  led: LED identifier.
+  * @param  level: 0 (off) .. 255 (fully on).
+  * @retval None
+  */
+void led_bcm_set(led_id_t led, uint8_t level);
+
+/**
+  * @brief  Get the BCM level of an LED.
+  * @param  led: LED identifier.
+  * @retval Current level, 0 if the LED is not driven by BCM.
+  */
+uint8_t led_bcm_get(led_id_t led);
+
+/**
+  * @brief  Check which LEDs are driven by BCM.
+  * @retval Mask of LEDs currently owned by the BCM backend.
+  */
+led_mask_t led_bcm_active(void);
+
+/**
+  * @brief  Stop driving LEDs by BCM.
+  * @note   Interrupt-safe. The timer interrupt stops touching the pins as
+  *         soon as this returns, so a following BSRR write sticks.
+  * @param  leds: LEDs to hand back to plain on/off control.
+  * @retval None
+  */
+void led_bcm_release(led_mask_t leds);
+
+/**
+  * @brief  BCM timer update interrupt handler.
+  * @note   Call from the IRQ handler of LED_BCM_TIMER.
+  * @retval None
+  */
+void led_bcm_timer_handler(void);
+
+#endif /* LED_BCM_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    led_stream.h
+  * @brief   DMA-streamed BSRR waveform playback for the LED port.
+  ******************************************************************************
+  */
+#ifndef LED_STREAM_H
+#define LED_STREAM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Refill callback for open-ended streams.
+  * @note   Runs in the DMA interrupt. Must fill @p count BSRR words before the
+  *         other half of the buffer has been played out.
+  * @param  words: Buffer half to fill.
+  * @param  count: Number of words to write.
+  * @param  context: User pointer passed to led_stream_start().
+  */
+typedef void (*led_stream_refill_t)(uint32_t *words, uint16_t count, void *context);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Initialize the stream timer and DMA stream.
+  * @note   Call after led_init(). Output stays idle until a play/start call.
+  * @retval None
+  */
+void led_stream_init(void);
+
+/**
+  * @brief  Loop a fixed sequence of BSRR words forever.
+  * @note   The DMA runs in circular mode straight from @p words, so the
+  *         sequence costs no CPU at all while it plays. @p words must stay
+  *         valid (flash or static RAM) until led_stream_stop().
+  * @param  words: BSRR words, one per frame (see led_stream_word()).
+  * @param  count: Number of frames in the sequence (1..65535).
+  * @param  frame_period_us: Time each frame is shown.
+  * @param  first_elapsed_us: Time the first frame has already been shown,
+  *         so a restart mid-frame keeps its phase (0 = a whole frame).
+  * @retval None
+  */
+void led_stream_play(const uint32_t *words, uint16_t count, uint32_t frame_period_us,
+                     uint32_t first_elapsed_us);
+
+/**
+  * @brief  Stream an open-ended waveform generated by @p refill.
+  * @note   Both buffer halves are filled before the first frame. After that
+  *         @p refill is called from the half-transfer and transfer-complete
+  *         interrupts, once per LED_STREAM_BUFFER_WORDS / 2 frames.
+  * @param  frame_period_us: Time each frame is shown.
+  * @param  refill: Buffer fill callback.
+  * @param  context: User pointer handed to @p refill.
+  * @retval None
+  */
+void led_stream_start(uint32_t frame_period_us, led_stream_refill_t refill, void *context);
+
+/**
+  * @brief  Stop playback. The LEDs keep the last frame written.
+  * @retval Index of the next frame that would have been played.
+  */
+uint16_t led_stream_stop(void);
+
+/**
+  * @brief  Check whether a stream is playing.
+  * @retval true if the DMA stream is running.
+  */
+bool led_stream_is_active(void);
+
+/**
+  * @brief  Build the BSRR word that shows an LED pattern on the stream port.
+  * @param  pattern: Same layout as led_set_pattern() (bit0 GREEN .. bit3 BLUE).
+  * @retval Word setting the lit LEDs and resetting the others in one write.
+  * @note   Only LEDs on LED_STREAM_PORT can be streamed.
+  */
+uint32_t led_stream_word(uint8_t pattern);
+
+/**
+  * @brief  DMA stream interrupt handler.
+  * @note   Call from the IRQ handler of LED_STREAM_DMA_STREAM.
+  * @retval None
+  */
+void led_stream_dma_handler(void);
+
+#endif /* LED_STREAM_H */
+
+/******************************** END OF FILE *********************************/
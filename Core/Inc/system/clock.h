@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    clock.h
+  * @brief   Bus and timer clock queries.
+  ******************************************************************************
+  */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Get the kernel clock of timers on APB1 (TIM2-TIM7, TIM12-TIM14).
+  * @note   Derived from SystemCoreClock and the current APB1 prescaler.
+  * @retval Timer clock in Hz.
+  */
+uint32_t clock_get_apb1_timer_hz(void);
+
+/**
+  * @brief  Get the kernel clock of timers on APB2 (TIM1, TIM8-TIM11).
+  * @note   Derived from SystemCoreClock and the current APB2 prescaler.
+  * @retval Timer clock in Hz.
+  */
+uint32_t clock_get_apb2_timer_hz(void);
+
+#endif /* CLOCK_H */
+
+/******************************** END OF FILE *********************************/
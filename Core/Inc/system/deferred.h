@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    deferred.h
+  * @brief   Deferred work (bottom halves) run from PendSV.
+  *
+  *          An interrupt does the minimum at its own priority, posts a work
+  *          item and returns; PendSV runs at the lowest priority and calls
+  *          the items in order once no other interrupt is active. Posting is
+  *          lock-free and safe from any priority and from thread mode.
+  ******************************************************************************
+  */
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Work item function.
+  * @param  arg: Value given to deferred_post().
+  */
+typedef void (*deferred_fn_t)(uint32_t arg);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set PendSV to the lowest priority and empty the queue.
+  * @note   Call before enabling any interrupt that posts work.
+  * @retval None
+  */
+void deferred_init(void);
+
+/**
+  * @brief  Queue a work item and pend PendSV.
+  * @note   Multi-producer: slots are claimed with LDREX/STREX, so callers
+  *         at any priority may post concurrently without masking
+  *         interrupts.
+  * @param  fn: Function to run from PendSV.
+  * @param  arg: Passed to @p fn.
+  * @retval true if queued, false if the queue was full (counted as dropped).
+  */
+bool deferred_post(deferred_fn_t fn, uint32_t arg);
+
+/**
+  * @brief  Get how many work items were dropped because the queue was full.
+  * @retval Items lost since deferred_init().
+  */
+uint32_t deferred_get_dropped(void);
+
+/**
+  * @brief  Run the queued work items, oldest first.
+  * @note   Call from PendSV_Handler() only: it is the single consumer.
+  * @retval None
+  */
+void deferred_run(void);
+
+#endif /* DEFERRED_H */
+
+/******************************** END OF FILE *********************************/
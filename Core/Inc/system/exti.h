@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    exti.h
+  * @brief   EXTI line dispatcher.
+  *
+  *          Drivers register callbacks per EXTI line (0-15) instead of owning
+  *          a vector. Every EXTI vector, the shared EXTI9_5 and EXTI15_10
+  *          included, funnels into exti_handler(), which only clears the
+  *          lines that fired and defers them to PendSV (see deferred.h);
+  *          the callbacks run there, finding lines with __CLZ, so the cost
+  *          follows the lines that fired rather than the lines in use.
+  ******************************************************************************
+  */
+#ifndef EXTI_H
+#define EXTI_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Line callback, called from PendSV (lowest priority) with the
+  *         line's pending bit already cleared. Several edges of a line
+  *         before it runs give a single call.
+  * @param  line: EXTI line that fired (0-15).
+  */
+typedef void (*exti_callback_t)(uint8_t line);
+
+/**
+  * @brief  Edges that trigger a line.
+  */
+typedef enum {
+    EXTI_TRIGGER_RISING  = 1,
+    EXTI_TRIGGER_FALLING = 2,
+    EXTI_TRIGGER_BOTH    = 3
+} exti_trigger_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define EXTI_LINE_COUNT     16U
+
+/* Lines served by each vector, for exti_handler() */
+#define EXTI_LINES_0        0x0001UL
+#define EXTI_LINES_1        0x0002UL
+#define EXTI_LINES_2        0x0004UL
+#define EXTI_LINES_3        0x0008UL
+#define EXTI_LINES_4        0x0010UL
+#define EXTI_LINES_9_5      0x03E0UL
+#define EXTI_LINES_15_10    0xFC00UL
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Route a GPIO pin to its EXTI line and set the trigger edges.
+  * @note   The line stays masked; exti_enable() unmasks it.
+  * @param  port: GPIO port of the pin.
+  * @param  line: Pin number = EXTI line (0-15).
+  * @param  trigger: Edges that set the pending bit.
+  * @retval None
+  */
+void exti_configure(GPIO_TypeDef *port, uint8_t line, exti_trigger_t trigger);
+
+/**
+  * @brief  Add a callback to a line.
+  * @note   A line may have up to EXTI_CALLBACKS_PER_LINE callbacks; the
+  *         most recently registered runs first, so a layer registered later
+  *         (e.g. the sleep manager's wake-up) acts before the driver below.
+  * @param  line: EXTI line (0-15).
+  * @param  callback: Function to call when the line fires.
+  * @retval true if registered, false if the line is full or invalid.
+  */
+bool exti_register(uint8_t line, exti_callback_t callback);
+
+/**
+  * @brief  Unmask a line and enable its vector.
+  * @note   Lines 5-9 and 10-15 share a vector, hence its priority.
+  * @param  line: EXTI line (0-15).
+  * @param  priority: NVIC priority of the line's vector.
+  * @retval None
+  */
+void exti_enable(uint8_t line, uint32_t priority);
+
+/**
+  * @brief  Mask a line.
+  * @note   The vector stays enabled, other lines may share it.
+  * @param  line: EXTI line (0-15).
+  * @retval None
+  */
+void exti_disable(uint8_t line);
+
+/**
+  * @brief  Have a line masked by the interrupt itself when it fires.
+  * @note   For drivers that act on the first edge and ignore the line for a
+  *         while after (debouncing): later edges cannot fire again before
+  *         the deferred callback runs. exti_enable() re-arms the line.
+  * @param  line: EXTI line (0-15).
+  * @param  oneshot: true to mask on fire, false for a normal line.
+  * @retval None
+  */
+void exti_set_oneshot(uint8_t line, bool oneshot);
+
+/**
+  * @brief  Serve the pending lines of one vector.
+  * @note   Call from the EXTIx_IRQHandler()s with that vector's EXTI_LINES_x.
+  *         Masked lines are left pending. Clears the rest with one write and
+  *         posts the bottom half; no callback runs here. Lines that fired
+  *         are never dropped: if the deferred queue is full they wait for
+  *         exti_retry() or the next dispatch.
+  * @param  lines: Lines the vector serves.
+  * @retval None
+  */
+void exti_handler(uint32_t lines);
+
+/**
+  * @brief  Post the bottom half again if a full queue refused it.
+  * @note   Call from PendSV_Handler() after deferred_run(), once the queue
+  *         has drained.
+  * @retval None
+  */
+void exti_retry(void);
+
+#endif /* EXTI_H */
+
+/******************************** END OF FILE *********************************/
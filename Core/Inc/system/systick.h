@@ -11,6 +11,13 @@
 
 /* Exported macros -----------------------------------------------------------*/
 
+/**
+  * @brief  Wrap-safe "tick a is earlier than tick b".
+  * @note   Valid while the two ticks are less than 2^31 apart. Works for
+  *         any free-running 32-bit count, e.g. the button clock in us.
+  */
+#define SYSTICK_BEFORE(a, b)    ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
 /* Exported functions --------------------------------------------------------*/
 
 /**
@@ -36,6 +43,13 @@ uint32_t systick_get_ticks(void);
   */
 bool systick_delay_elapsed(uint32_t last_tick, uint32_t delay_ms);
 
+/**
+  * @brief  Check if an absolute deadline has been reached (non-blocking).
+  * @param  deadline: Absolute tick, e.g. systick_get_ticks() + delay.
+  * @retval true once the current tick is at or past @p deadline.
+  */
+bool systick_deadline_reached(uint32_t deadline);
+
 
 /**
   * @brief  Busy-wait delay (blocking).
@@ -1,14 +1,44 @@
 #include "stm32f4xx.h"
 #include "led.h"
+#include "led_stream.h"
 #include "button.h"
 #include "systick.h"
+#include "deferred.h"
 #include "pattern_manager.h"
+#include "playlist.h"
 #include "sleep_manager.h"
+#include "board_config.h"
+
+#define EVENT_BATCH  4U     /* Button events handled per loop pass */
+
+#if PLAYLIST_AUTOSTART
+/* Unattended show: pattern, ms per play (0 = one cycle), speed %, plays */
+static const playlist_entry_t show[] = {
+    { PATTERN_CHASE_CLOCKWISE,     4000,   0, 0 },
+    { PATTERN_CHASE_CLOCKWISE,     2000, 200, 0 },
+    { PATTERN_KNIGHT_RIDER,        6000,   0, 0 },
+    { PATTERN_BREATHE,                0,   0, 3 },
+    { PATTERN_RAINBOW,             5000, 150, 0 },
+    { PATTERN_RANDOM_TWINKLE,      8000,   0, 0 },
+};
+#endif
+
+/* Short press action: pause and show it, or resume */
+static void toggle_pause(void) {
+    if (pattern_manager_get_state() == PATTERN_STATE_RUNNING) {
+        pattern_manager_pause();
+        led_set_pattern(0b1010);  // Show paused state
+    } else {
+        pattern_manager_resume();
+    }
+}
 
 int main(void) {
     /* 1. Initialize system (ORDER MATTERS!) */
     systick_init();             /* Must be first for timing */
+    deferred_init();            /* PendSV bottom halves, before any IRQ posts */
     led_init();                 /* Initialize LEDs */
+    led_stream_init();          /* Initialize DMA LED playback */
     button_init();              /* Initialize button with EXTI */
     pattern_manager_init();     /* Initialize pattern manager */
     sleep_manager_init();       /* Initialize sleep manager */
@@ -25,14 +55,17 @@ int main(void) {
     }
 
     /* 4. Start with first pattern */
+#if PLAYLIST_AUTOSTART
+    playlist_start(show, (uint8_t)(sizeof(show) / sizeof(show[0])), true);
+#else
     pattern_manager_set_pattern(PATTERN_SOLID);
     pattern_manager_start();
+#endif
 
     /* 5. Main superloop */
-    while (1) {
-        /* Update button state machine */
-        button_update();
+    uint32_t next_frame = systick_get_ticks();
 
+    while (1) {
         /* Check for wakeup request */
         static bool was_sleeping = false;
         if (sleep_manager_is_sleeping() && !was_sleeping) {
@@ -47,59 +80,82 @@ int main(void) {
                     led_toggle(LED_GREEN);
                     sleep_blink_timer = systick_get_ticks();
                 }
-
-                // Check for wakeup
-                button_update();
             }
 
             was_sleeping = false;
             continue;  // Restart loop after wakeup
         }
 
-        /* Handle button events (only when awake) */
-        button_event_t event = button_get_event();
-
-        switch (event) {
-            case BUTTON_EVENT_PRESSED:
-                /* Short press: Toggle pattern pause/resume */
-                if (pattern_manager_get_state() == PATTERN_STATE_RUNNING) {
-                    pattern_manager_pause();
-                    led_set_pattern(0b1010);  // Show paused state
-                } else {
-                    pattern_manager_resume();
-                }
-                break;
-
-            case BUTTON_EVENT_LONG_PRESS:
-                /* Long press: Next pattern */
-                pattern_manager_next();
-
-                /* Visual feedback */
-                led_all_on();
-                for (volatile int i = 0; i < 20000; i++);
-                led_all_off();
-                break;
-
-            case BUTTON_EVENT_DOUBLE_CLICK:
-                /* Double click: Enter sleep mode */
-                sleep_manager_enter();
-                break;
-
-            case BUTTON_EVENT_RELEASED:
-                /* Release events can be used for additional features */
-                break;
-
-            default:
-                /* No event */
-                break;
+        /* Handle button events (only when awake), oldest first */
+        button_event_record_t events[EVENT_BATCH];
+        uint8_t event_count = button_read_events(events, EVENT_BATCH);
+
+        for (uint8_t i = 0; i < event_count; i++) {
+            switch (events[i].event) {
+                case BUTTON_EVENT_PRESS_PROVISIONAL:
+                    /* First edge: act now, keep a way back */
+                    pattern_manager_provisional_begin();
+                    toggle_pause();
+                    break;
+
+                case BUTTON_EVENT_PRESSED:
+                    /* Short press: Toggle pattern pause/resume, unless the
+                       provisional press already did */
+                    if (pattern_manager_provisional_pending()) {
+                        pattern_manager_provisional_commit();
+                    } else {
+                        toggle_pause();
+                    }
+                    break;
+
+                case BUTTON_EVENT_PRESS_RETRACTED:
+                    /* It was a glitch: put things back */
+                    if (pattern_manager_provisional_rollback() &&
+                        pattern_manager_get_state() == PATTERN_STATE_PAUSED) {
+                        led_set_pattern(0b1010);  // Show paused state
+                    }
+                    break;
+
+                case BUTTON_EVENT_LONG_PRESS:
+                case BUTTON_EVENT_CLICK_HOLD:
+                    /* Long press: Next pattern (the crossfade is the feedback) */
+                    if (playlist_is_active()) {
+                        playlist_next();
+                    } else {
+                        pattern_manager_next();
+                    }
+                    break;
+
+                case BUTTON_EVENT_DOUBLE_CLICK:
+                    /* Double click: Enter sleep mode */
+                    sleep_manager_enter();
+                    break;
+
+                case BUTTON_EVENT_RELEASED:
+                    /* Release events can be used for additional features */
+                    break;
+
+                default:
+                    /* No event */
+                    break;
+            }
         }
 
         /* Update pattern (when not sleeping) */
         if (!sleep_manager_is_sleeping()) {
-            pattern_manager_update();
+            uint32_t next_entry = playlist_update();
+
+            next_frame = pattern_manager_update();
+            if (SYSTICK_BEFORE(next_entry, next_frame)) {
+                next_frame = next_entry;
+            }
         }
 
-        /* Small delay to reduce CPU usage */
-        for (volatile int i = 0; i < 1000; i++);
+        /* Sleep until the next frame is due or a button event is queued.
+           Every interrupt wakes the core: SysTick once per ms (which also
+           scans the buttons), EXTI on a button edge. */
+        do {
+            __WFI();
+        } while (button_is_idle() && !systick_deadline_reached(next_frame));
     }
 }
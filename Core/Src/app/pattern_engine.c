@@ -0,0 +1,362 @@
+/**
+  ******************************************************************************
+  * @file    pattern_engine.c
+  * @brief   Keyframe pattern interpreter implementation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pattern_engine.h"
+#include "systick.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static bool program_is_one_shot(const pattern_program_t *program);
+static uint32_t player_scale(const pattern_player_t *player, uint32_t program_ms);
+static void player_locate(pattern_player_t *player, uint32_t now_ms);
+static void player_enter(pattern_player_t *player, uint8_t index, uint32_t start_ms);
+static uint8_t random_mask(prng_t *rng, uint8_t candidates, uint8_t pick);
+
+/* Exported functions --------------------------------------------------------*/
+
+void pattern_player_start(pattern_player_t *player, const pattern_program_t *program, uint32_t now_ms) {
+    if (program == 0 || program->frame_count == 0) {
+        pattern_player_stop(player);
+        return;
+    }
+
+    if (player->rng.state == 0) {
+        prng_seed(&player->rng, 0);
+    }
+    if (player->speed == 0) {
+        player->speed = PATTERN_SPEED_NORMAL;
+    }
+
+    player->program = program;
+    player->cycle_ms = 0;
+    for (uint8_t i = 0; i < program->frame_count; i++) {
+        player->cycle_ms += pattern_player_frame_ms(player, program, i);
+    }
+    player->level = 0;
+    pattern_player_seek(player, 0, now_ms);
+}
+
+void pattern_player_seed(pattern_player_t *player, uint32_t seed) {
+    prng_seed(&player->rng, seed);
+}
+
+void pattern_player_set_speed(pattern_player_t *player, uint16_t speed, uint32_t now_ms) {
+    const pattern_program_t *program = player->program;
+
+    if (speed == 0) speed = PATTERN_SPEED_NORMAL;
+    if (program == 0 || player->speed == 0) {
+        player->speed = speed;
+        return;
+    }
+
+    // Keep the position in program time, then measure the cycle again
+    uint32_t program_ms = (uint32_t)(((uint64_t)pattern_player_phase(player, now_ms) * player->speed) /
+                                     PATTERN_SPEED_NORMAL);
+
+    player->speed = speed;
+    player->cycle_ms = 0;
+    for (uint8_t i = 0; i < program->frame_count; i++) {
+        player->cycle_ms += pattern_player_frame_ms(player, program, i);
+    }
+    pattern_player_seek(player, player_scale(player, program_ms), now_ms);
+}
+
+void pattern_player_stop(pattern_player_t *player) {
+    player->program = 0;
+    player->fresh = false;
+}
+
+bool pattern_player_update(pattern_player_t *player, uint32_t now_ms) {
+    const pattern_program_t *program = player->program;
+
+    if (program == 0) return false;
+    if (!player->fresh && (player->frame_ms == 0 || SYSTICK_BEFORE(now_ms, player->next_ms))) {
+        return false;
+    }
+
+    uint8_t old_mask = player->mask;
+    uint8_t old_level = player->level;
+
+    if (!player->located) {
+        player_locate(player, now_ms);
+    } else if (player->frame_ms != 0 &&
+               !SYSTICK_BEFORE(now_ms, player->frame_start_ms + player->frame_ms)) {
+        uint32_t frame_end = player->frame_start_ms + player->frame_ms;
+        uint8_t next = (player->index + 1U < program->frame_count) ? player->index + 1U : 0;
+
+        // Jitter stretches the timeline rather than being lost as drift
+        player->origin_ms += player->frame_ms - pattern_player_frame_ms(player, program, player->index);
+
+        // Chain from the previous frame end, so frames stay on the timeline
+        player_enter(player, next, frame_end);
+
+        // More than a whole frame late: jump to where the timeline is now
+        if (player->frame_ms != 0 && !SYSTICK_BEFORE(now_ms, frame_end + player->frame_ms)) {
+            player_locate(player, now_ms);
+        }
+    }
+
+    const pattern_keyframe_t *kf = &program->frames[player->index];
+    uint32_t frame_end = player->frame_start_ms + player->frame_ms;
+
+    if ((kf->flags & PATTERN_KF_RAMP) && player->frame_ms != 0) {
+        uint8_t next = (player->index + 1U < program->frame_count) ? player->index + 1U : 0;
+        int32_t span = (int32_t)program->frames[next].level - (int32_t)kf->level;
+        int32_t elapsed = (int32_t)(now_ms - player->frame_start_ms);
+
+        player->level = (uint8_t)((int32_t)kf->level + (span * elapsed) / (int32_t)player->frame_ms);
+
+        player->next_ms = now_ms + PATTERN_RAMP_STEP_MS;
+        if (SYSTICK_BEFORE(frame_end, player->next_ms)) {
+            player->next_ms = frame_end;
+        }
+    } else {
+        player->level = kf->level;
+        player->next_ms = frame_end;
+    }
+
+    bool changed = player->fresh || player->mask != old_mask || player->level != old_level;
+    player->fresh = false;
+
+    return changed;
+}
+
+void pattern_player_shift(pattern_player_t *player, uint32_t delta_ms) {
+    player->origin_ms += delta_ms;
+    player->frame_start_ms += delta_ms;
+    player->next_ms += delta_ms;
+    player->fresh = true;
+}
+
+void pattern_player_redraw(pattern_player_t *player) {
+    player->fresh = true;
+}
+
+void pattern_player_seek(pattern_player_t *player, uint32_t phase_ms, uint32_t now_ms) {
+    if (player->cycle_ms != 0 && !program_is_one_shot(player->program)) {
+        phase_ms %= player->cycle_ms;
+    }
+
+    player->origin_ms = now_ms - phase_ms;
+    player->next_ms = now_ms;
+    player->located = false;
+    player->fresh = true;
+}
+
+uint32_t pattern_player_phase(const pattern_player_t *player, uint32_t now_ms) {
+    if (player->program == 0 || player->cycle_ms == 0) return 0;
+
+    uint32_t offset = now_ms - player->origin_ms;
+
+    if (program_is_one_shot(player->program)) {
+        return (offset < player->cycle_ms) ? offset : player->cycle_ms;
+    }
+    return offset % player->cycle_ms;
+}
+
+uint32_t pattern_player_frame_ms(const pattern_player_t *player, const pattern_program_t *program,
+                                 uint8_t index) {
+    return player_scale(player, program->frames[index].duration_ms);
+}
+
+bool pattern_player_next_deadline(const pattern_player_t *player, uint32_t *deadline_ms) {
+    if (player->program == 0) return false;
+    if (!player->fresh && player->frame_ms == 0) return false;
+
+    *deadline_ms = player->next_ms;
+    return true;
+}
+
+uint32_t pattern_player_levels(const pattern_player_t *player) {
+    if (player->program == 0) return 0;
+
+    // Spread mask bits 0..3 to bit 0 of bytes 0..3, then scale each byte
+    uint32_t lanes = ((player->mask & 0x0FU) * 0x00204081UL) & 0x01010101UL;
+
+    return lanes * player->level;
+}
+
+uint32_t pattern_blend(uint32_t from, uint32_t to, uint32_t weight) {
+    uint32_t keep = PATTERN_BLEND_ONE - weight;
+
+    uint32_t even = ((from & 0x00FF00FFUL) * keep + (to & 0x00FF00FFUL) * weight) >> 8;
+    uint32_t odd = (((from >> 8) & 0x00FF00FFUL) * keep + ((to >> 8) & 0x00FF00FFUL) * weight) >> 8;
+
+    return (even & 0x00FF00FFUL) | ((odd & 0x00FF00FFUL) << 8);
+}
+
+uint32_t pattern_program_cycle_ms(const pattern_program_t *program) {
+    uint32_t cycle_ms = 0;
+
+    for (uint8_t i = 0; i < program->frame_count; i++) {
+        cycle_ms += program->frames[i].duration_ms;
+    }
+    return cycle_ms;
+}
+
+uint8_t pattern_program_frame_at(const pattern_program_t *program, uint32_t offset_ms,
+                                 uint32_t *frame_offset_ms) {
+    uint32_t start = 0;
+    uint8_t i;
+
+    for (i = 0; i + 1U < program->frame_count; i++) {
+        uint32_t duration = program->frames[i].duration_ms;
+
+        if (duration == 0 || offset_ms < start + duration) break;
+        start += duration;
+    }
+
+    *frame_offset_ms = start;
+    return i;
+}
+
+bool pattern_program_is_periodic(const pattern_program_t *program) {
+    if (program == 0 || program->frame_count == 0) return false;
+
+    uint16_t duration_ms = program->frames[0].duration_ms;
+    if (duration_ms == 0) return false;
+
+    for (uint8_t i = 0; i < program->frame_count; i++) {
+        const pattern_keyframe_t *kf = &program->frames[i];
+
+        if (kf->duration_ms != duration_ms || kf->level != PATTERN_LEVEL_FULL || kf->flags != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool pattern_program_is_streamable(const pattern_program_t *program) {
+    return pattern_program_is_periodic(program) &&
+           program->frame_count <= PATTERN_STREAM_MAX_FRAMES;
+}
+
+bool pattern_program_from_blob(const void *blob, uint32_t size, pattern_program_t *program) {
+    const pattern_blob_header_t *header = (const pattern_blob_header_t *)blob;
+
+    if (blob == 0 || size < sizeof(*header)) return false;
+    if (header->magic != PATTERN_BLOB_MAGIC || header->version != PATTERN_BLOB_VERSION) return false;
+    if (header->frame_count == 0 ||
+        size < sizeof(*header) + (uint32_t)header->frame_count * sizeof(pattern_keyframe_t)) {
+        return false;
+    }
+
+    program->frames = (const pattern_keyframe_t *)(header + 1);
+    program->frame_count = header->frame_count;
+    return true;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Check whether a program ends in a hold frame instead of looping.
+  * @param  program: Program to check.
+  * @retval true if the last keyframe has no duration.
+  */
+static bool program_is_one_shot(const pattern_program_t *program) {
+    return program->frames[program->frame_count - 1U].duration_ms == 0;
+}
+
+/**
+  * @brief  Convert authored milliseconds to milliseconds at the player's speed.
+  * @param  player: Player state.
+  * @param  program_ms: Duration as written in the program.
+  * @retval Scaled duration.
+  */
+static uint32_t player_scale(const pattern_player_t *player, uint32_t program_ms) {
+    if (player->speed == PATTERN_SPEED_NORMAL || player->speed == 0) return program_ms;
+
+    uint32_t scaled = (program_ms * PATTERN_SPEED_NORMAL) / player->speed;
+
+    // A timed frame never collapses into a 0 ms hold frame
+    return (scaled != 0 || program_ms == 0) ? scaled : 1U;
+}
+
+/**
+  * @brief  Enter the keyframe the timeline shows at @p now_ms.
+  * @param  player: Player state.
+  * @param  now_ms: Current tick.
+  * @retval None
+  */
+static void player_locate(pattern_player_t *player, uint32_t now_ms) {
+    const pattern_program_t *program = player->program;
+    uint32_t offset = pattern_player_phase(player, now_ms);
+    uint32_t frame_offset = 0;
+    uint8_t index;
+
+    // Same walk as pattern_program_frame_at(), over the scaled durations
+    for (index = 0; index + 1U < program->frame_count; index++) {
+        uint32_t duration = pattern_player_frame_ms(player, program, index);
+
+        if (duration == 0 || offset < frame_offset + duration) break;
+        frame_offset += duration;
+    }
+
+    player_enter(player, index, now_ms - offset + frame_offset);
+    player->located = true;
+}
+
+/**
+  * @brief  Make a keyframe current, resolving its random mask and jitter.
+  * @note   Random values are drawn once here, not on every update.
+  * @param  player: Player state.
+  * @param  index: Keyframe to enter.
+  * @param  start_ms: Tick the frame starts at.
+  * @retval None
+  */
+static void player_enter(pattern_player_t *player, uint8_t index, uint32_t start_ms) {
+    const pattern_keyframe_t *kf = &player->program->frames[index];
+
+    player->index = index;
+    player->frame_start_ms = start_ms;
+    player->frame_ms = pattern_player_frame_ms(player, player->program, index);
+    player->mask = kf->mask;
+
+    if (kf->flags & PATTERN_KF_RANDOM) {
+        uint8_t pick = (uint8_t)((kf->flags & PATTERN_KF_PICK_Msk) >> PATTERN_KF_PICK_Pos);
+
+        player->mask = random_mask(&player->rng, kf->mask, (pick != 0) ? pick : 1U);
+        if (kf->jitter != 0 && player->frame_ms != 0) {
+            uint32_t jitter_ms = prng_range(&player->rng, (uint32_t)kf->jitter * PATTERN_JITTER_UNIT_MS);
+
+            player->frame_ms += player_scale(player, jitter_ms);
+        }
+    }
+}
+
+/**
+  * @brief  Light 1..pick LEDs drawn (with repeats) from a candidate mask.
+  * @param  rng: Generator to draw from.
+  * @param  candidates: LEDs that may be lit.
+  * @param  pick: Maximum number of draws.
+  * @retval Resulting mask.
+  */
+static uint8_t random_mask(prng_t *rng, uint8_t candidates, uint8_t pick) {
+    uint8_t count = 0;
+    uint8_t mask = 0;
+
+    for (uint8_t bits = candidates; bits; bits &= (uint8_t)(bits - 1U)) {
+        count++;
+    }
+    if (count == 0) return 0;
+
+    uint8_t draws = (uint8_t)(1U + prng_range(rng, pick));
+
+    while (draws--) {
+        // Select the k-th set bit of the candidates
+        uint8_t k = (uint8_t)prng_range(rng, count);
+        uint8_t bits = candidates;
+
+        while (k--) {
+            bits &= (uint8_t)(bits - 1U);
+        }
+        mask |= (uint8_t)(bits & -bits);
+    }
+    return mask;
+}
+
+/******************************** END OF FILE *********************************/
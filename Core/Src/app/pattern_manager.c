@@ -7,11 +7,14 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "pattern_manager.h"
+#include "pattern_engine.h"
 #include "led.h"
+#include "led_stream.h"
 #include "systick.h"
-#include <stdlib.h>
-
-/* Private typedef -----------------------------------------------------------*/
+#include "board_config.h"
+#if RNG_HW_ENABLED
+#include "hw_rng.h"
+#endif
 
 /* Private define ------------------------------------------------------------*/
 #define CHASE_DELAY_MS       150   /*!< Chase pattern delay */
@@ -20,52 +23,217 @@
 #define TWINKLE_MIN_DELAY_MS  100  /*!< Minimum twinkle delay */
 #define TWINKLE_MAX_DELAY_MS  800  /*!< Maximum twinkle delay */
 
+#define LEDS_ALL             0x0FU /*!< Keyframe mask of the four LEDs */
+
+#define TRANSITION_DEFAULT_MS 400U /*!< Crossfade between patterns */
+
+#define SEED_SPREAD          0x9E3779B9UL /*!< Decorrelates per-pattern seeds */
+
+#if LED_COUNT > PATTERN_LEVEL_LANES
+#error "Crossfades blend at most PATTERN_LEVEL_LANES LEDs"
+#endif
+
 /* Private macro -------------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
+
+/* Keyframe tables, one per pattern; adding a pattern needs only a table */
+static const pattern_keyframe_t solid_frames[] = {
+    PATTERN_FRAME(0, LEDS_ALL),
+};
+static const pattern_keyframe_t blink_slow_frames[] = {
+    PATTERN_FRAME(500, LEDS_ALL), PATTERN_FRAME(500, 0),
+};
+static const pattern_keyframe_t blink_fast_frames[] = {
+    PATTERN_FRAME(125, LEDS_ALL), PATTERN_FRAME(125, 0),
+};
+static const pattern_keyframe_t chase_cw_frames[] = {
+    // Green → Orange → Red → Blue
+    PATTERN_FRAME(CHASE_DELAY_MS, 0b0001), PATTERN_FRAME(CHASE_DELAY_MS, 0b0010),
+    PATTERN_FRAME(CHASE_DELAY_MS, 0b0100), PATTERN_FRAME(CHASE_DELAY_MS, 0b1000),
+};
+static const pattern_keyframe_t chase_acw_frames[] = {
+    // Blue → Red → Orange → Green
+    PATTERN_FRAME(CHASE_DELAY_MS, 0b1000), PATTERN_FRAME(CHASE_DELAY_MS, 0b0100),
+    PATTERN_FRAME(CHASE_DELAY_MS, 0b0010), PATTERN_FRAME(CHASE_DELAY_MS, 0b0001),
+};
+static const pattern_keyframe_t knight_rider_frames[] = {
+    // 0,1,2,3,2,1 ping-pong without a dark frame in between
+    PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b0001), PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b0010),
+    PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b0100), PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b1000),
+    PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b0100), PATTERN_FRAME(KNIGHT_RIDER_DELAY_MS, 0b0010),
+};
+static const pattern_keyframe_t breathe_frames[] = {
+    // Ramp up then down; the perceptual curve is applied on output
+    { BREATHE_CYCLE_MS / 2, LEDS_ALL, 0,                  PATTERN_KF_RAMP, 0 },
+    { BREATHE_CYCLE_MS / 2, LEDS_ALL, PATTERN_LEVEL_FULL, PATTERN_KF_RAMP, 0 },
+};
+static const pattern_keyframe_t rainbow_frames[] = {
+    PATTERN_FRAME(500, 0b0001),  // Green only
+    PATTERN_FRAME(500, 0b0011),  // Green + Orange
+    PATTERN_FRAME(500, 0b0110),  // Orange + Red
+    PATTERN_FRAME(500, 0b1100),  // Red + Blue
+    PATTERN_FRAME(500, 0b1001),  // Blue + Green
+    PATTERN_FRAME(500, 0b0101),  // Green + Red
+    PATTERN_FRAME(500, 0b1010),  // Orange + Blue
+    PATTERN_FRAME(500, 0b1111),  // All on
+};
+static const pattern_keyframe_t twinkle_frames[] = {
+    // 1-2 random LEDs for 100..800 ms
+    { TWINKLE_MIN_DELAY_MS, LEDS_ALL, PATTERN_LEVEL_FULL, PATTERN_KF_RANDOM | PATTERN_KF_PICK(2),
+      (TWINKLE_MAX_DELAY_MS - TWINKLE_MIN_DELAY_MS) / PATTERN_JITTER_UNIT_MS },
+};
+
+/**
+  * @brief  Program of each pattern, indexed by pattern_t.
+  */
+static const pattern_program_t programs[PATTERN_COUNT] = {
+    [PATTERN_SOLID]               = PATTERN_PROGRAM(solid_frames),
+    [PATTERN_BLINK_SLOW]          = PATTERN_PROGRAM(blink_slow_frames),
+    [PATTERN_BLINK_FAST]          = PATTERN_PROGRAM(blink_fast_frames),
+    [PATTERN_CHASE_CLOCKWISE]     = PATTERN_PROGRAM(chase_cw_frames),
+    [PATTERN_CHASE_ANTICLOCKWISE] = PATTERN_PROGRAM(chase_acw_frames),
+    [PATTERN_KNIGHT_RIDER]        = PATTERN_PROGRAM(knight_rider_frames),
+    [PATTERN_BREATHE]             = PATTERN_PROGRAM(breathe_frames),
+    [PATTERN_RAINBOW]             = PATTERN_PROGRAM(rainbow_frames),
+    [PATTERN_RANDOM_TWINKLE]      = PATTERN_PROGRAM(twinkle_frames),
+};
+
+#if LED_STREAM_ENABLED
+
+static uint32_t stream_words[2][PATTERN_STREAM_MAX_FRAMES]; /*!< BSRR words: playing cycle, spare */
+static uint8_t stream_buffer = 0;           /*!< Row of stream_words being played */
+static pattern_t stream_cued = PATTERN_COUNT; /*!< Pattern in the spare row, PATTERN_COUNT if none */
+static const pattern_program_t *stream_program = 0; /*!< Current program if streamable */
+#endif
+
 static pattern_t current_pattern = PATTERN_SOLID;
 static pattern_state_t pattern_state = PATTERN_STATE_STOPPED;
-static uint32_t pattern_timer = 0;
-static uint8_t pattern_step = 0;
-static bool breathe_direction = true;  /* true = brightening, false = dimming */
-static uint8_t breathe_step = 0;
+static pattern_player_t pattern_player;
+static uint32_t pause_tick = 0;             /*!< Tick pattern_manager_pause() ran */
+
+static pattern_player_t outgoing_player;    /*!< Previous pattern while crossfading */
+static uint32_t transition_start = 0;       /*!< Tick the crossfade began */
+static uint16_t transition_ms = TRANSITION_DEFAULT_MS;
+static bool transitioning = false;
+
+static uint16_t pattern_speed = PATTERN_SPEED_NORMAL;
+
+static uint32_t pattern_seed = PATTERN_RNG_SEED;
+static bool seed_fixed = !RNG_HW_ENABLED;   /*!< Replay from pattern_seed */
+
+static pattern_snapshot_t provisional;      /*!< State before a provisional action */
+static bool provisional_open = false;
 
 /* Private function prototypes -----------------------------------------------*/
-static void execute_solid_pattern(void);
-static void execute_blink_slow(void);
-static void execute_blink_fast(void);
-static void execute_chase_clockwise(void);
-static void execute_chase_anticlockwise(void);
-static void execute_knight_rider(void);
-static void execute_breathe(void);
-static void execute_rainbow(void);
-static void execute_random_twinkle(void);
+static void pattern_apply(const pattern_player_t *player);
+static void pattern_apply_levels(uint32_t levels);
+static uint32_t transition_update(uint32_t now);
+static void transition_end(void);
+static uint32_t pattern_seed_for(pattern_t pattern);
+static void pattern_start_at(uint32_t start_ms);
+#if LED_STREAM_ENABLED
+static const pattern_program_t *stream_program_for(pattern_t pattern);
+static void stream_pattern_play(void);
+static void stream_pattern_halt(void);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 
 void pattern_manager_init(void) {
     current_pattern = PATTERN_SOLID;
     pattern_state = PATTERN_STATE_STOPPED;
-    pattern_timer = systick_get_ticks();
-    pattern_step = 0;
-    breathe_direction = true;
-    breathe_step = 0;
+    pattern_player_stop(&pattern_player);
+
+#if RNG_HW_ENABLED
+    hw_rng_init();
+#endif
 }
 
 void pattern_manager_set_pattern(pattern_t pattern) {
+    pattern_manager_play(pattern, pattern_speed, systick_get_ticks());
+}
+
+void pattern_manager_play(pattern_t pattern, uint16_t speed, uint32_t start_ms) {
     if (pattern >= PATTERN_COUNT) return;
 
+    // Crossfade from whatever is on screen: keep rendering the old pattern
+    // (on its own timeline) alongside the new one until the fade is done
+    transitioning = (transition_ms != 0 && pattern_state == PATTERN_STATE_RUNNING &&
+                     pattern_player.program != 0);
+    if (transitioning) {
+        outgoing_player = pattern_player;
+        transition_start = systick_get_ticks();
+    }
+
     current_pattern = pattern;
-    pattern_step = 0;
-    pattern_timer = systick_get_ticks();
-    breathe_step = 0;
-    breathe_direction = true;
+    pattern_speed = (speed != 0) ? speed : PATTERN_SPEED_NORMAL;
 
-    // DO NOT turn LEDs off here
-    // led_all_off();  // ← REMOVE THIS LINE
+#if LED_STREAM_ENABLED
+    stream_pattern_halt();
+    stream_program = stream_program_for(pattern);
+#endif
 
     // Start pattern automatically
-    pattern_state = PATTERN_STATE_RUNNING;
+    pattern_start_at(start_ms);
+}
+
+uint32_t pattern_manager_cue(pattern_t pattern, uint16_t speed) {
+    if (pattern >= PATTERN_COUNT) return 0;
+
+    const pattern_program_t *program = &programs[pattern];
+    pattern_player_t timing = {0};
+    uint32_t cycle_ms = 0;
+
+    // A player without a program only takes the speed
+    pattern_player_set_speed(&timing, speed, 0);
+    for (uint8_t i = 0; i < program->frame_count; i++) {
+        cycle_ms += pattern_player_frame_ms(&timing, program, i);
+    }
+
+#if LED_STREAM_ENABLED
+    // The spare row is never read by the DMA, so it can be filled while the
+    // current pattern streams
+    if (stream_program_for(pattern) != 0) {
+        uint32_t *words = stream_words[stream_buffer ^ 1U];
+
+        for (uint8_t i = 0; i < program->frame_count; i++) {
+            words[i] = led_stream_word(program->frames[i].mask);
+        }
+        stream_cued = pattern;
+    }
+#endif
+
+    return cycle_ms;
+}
+
+void pattern_manager_set_transition(uint16_t duration_ms) {
+    transition_ms = duration_ms;
+}
+
+void pattern_manager_set_speed(uint16_t speed) {
+    pattern_speed = (speed != 0) ? speed : PATTERN_SPEED_NORMAL;
+    if (pattern_state == PATTERN_STATE_STOPPED) return;
+
+    uint32_t now = (pattern_state == PATTERN_STATE_PAUSED) ? pause_tick : systick_get_ticks();
+
+    pattern_player_set_speed(&pattern_player, pattern_speed, now);
+
+#if LED_STREAM_ENABLED
+    if (led_stream_is_active()) {
+        stream_pattern_halt();
+        stream_pattern_play();
+    }
+#endif
+}
+
+uint16_t pattern_manager_get_speed(void) {
+    return pattern_speed;
+}
+
+void pattern_manager_set_seed(uint32_t seed) {
+    pattern_seed = seed;
+    seed_fixed = true;
 }
 
 pattern_t pattern_manager_get_current(void) {
@@ -85,213 +253,361 @@ void pattern_manager_prev(void) {
 }
 
 void pattern_manager_start(void) {
-    pattern_state = PATTERN_STATE_RUNNING;
-    pattern_timer = systick_get_ticks();
+    // Timeline origin is now: the pattern starts at phase 0
+    pattern_start_at(systick_get_ticks());
 }
 
 void pattern_manager_stop(void) {
     pattern_state = PATTERN_STATE_STOPPED;
+    transitioning = false;
+
+#if LED_STREAM_ENABLED
+    stream_pattern_halt();
+#endif
+
+    pattern_player_stop(&pattern_player);
     led_all_off();
 }
 
 void pattern_manager_pause(void) {
+    if (pattern_state != PATTERN_STATE_RUNNING) return;
+
     pattern_state = PATTERN_STATE_PAUSED;
+    pause_tick = systick_get_ticks();
+
+    // A pause mid-fade settles on the new pattern
+    if (transitioning) {
+        transition_end();
+    }
+
+#if LED_STREAM_ENABLED
+    stream_pattern_halt();
+#endif
 }
 
 void pattern_manager_resume(void) {
+    if (pattern_state == PATTERN_STATE_STOPPED) {
+        pattern_manager_start();
+        return;
+    }
+    if (pattern_state != PATTERN_STATE_PAUSED) return;
+
     pattern_state = PATTERN_STATE_RUNNING;
+
+    // Slide the timeline by the paused time: same frame, same phase, redrawn
+    // at once since the LEDs may have been used for something else meanwhile
+    pattern_player_shift(&pattern_player, systick_get_ticks() - pause_tick);
+
+#if LED_STREAM_ENABLED
+    stream_pattern_play();
+#endif
 }
 
-void pattern_manager_update(void) {
-    if (pattern_state != PATTERN_STATE_RUNNING) return;
+void pattern_manager_seek(uint32_t phase_ms) {
+    uint32_t now = (pattern_state == PATTERN_STATE_PAUSED) ? pause_tick : systick_get_ticks();
 
-    switch (current_pattern) {
-        case PATTERN_SOLID:
-            execute_solid_pattern();
-            break;
+    pattern_player_seek(&pattern_player, phase_ms, now);
 
-        case PATTERN_BLINK_SLOW:
-            execute_blink_slow();
-            break;
+#if LED_STREAM_ENABLED
+    if (led_stream_is_active()) {
+        stream_pattern_halt();
+        stream_pattern_play();
+    }
+#endif
+}
 
-        case PATTERN_BLINK_FAST:
-            execute_blink_fast();
-            break;
+uint32_t pattern_manager_get_phase(void) {
+    uint32_t now = (pattern_state == PATTERN_STATE_PAUSED) ? pause_tick : systick_get_ticks();
 
-        case PATTERN_CHASE_CLOCKWISE:
-            execute_chase_clockwise();
-            break;
+    return pattern_player_phase(&pattern_player, now);
+}
 
-        case PATTERN_CHASE_ANTICLOCKWISE:
-            execute_chase_anticlockwise();
-            break;
+uint32_t pattern_manager_get_cycle_ms(void) {
+    if (pattern_player.program != 0) return pattern_player.cycle_ms;
 
-        case PATTERN_KNIGHT_RIDER:
-            execute_knight_rider();
-            break;
+    return pattern_program_cycle_ms(&programs[current_pattern]);
+}
 
-        case PATTERN_BREATHE:
-            execute_breathe();
-            break;
+void pattern_manager_snapshot(pattern_snapshot_t *snapshot) {
+    if (transitioning) {
+        transition_end();
+    }
 
-        case PATTERN_RAINBOW:
-            execute_rainbow();
+    snapshot->pattern = current_pattern;
+    snapshot->state = pattern_state;
+    snapshot->speed = pattern_speed;
+    snapshot->taken_ms = (pattern_state == PATTERN_STATE_PAUSED) ? pause_tick : systick_get_ticks();
+    snapshot->player = pattern_player;
+}
+
+void pattern_manager_restore(const pattern_snapshot_t *snapshot) {
+    if (snapshot->pattern >= PATTERN_COUNT) return;
+
+    uint32_t now = systick_get_ticks();
+
+#if LED_STREAM_ENABLED
+    stream_pattern_halt();
+    stream_program = stream_program_for(snapshot->pattern);
+#endif
+
+    transitioning = false;
+    current_pattern = snapshot->pattern;
+    pattern_speed = snapshot->speed;
+    pattern_player = snapshot->player;
+
+    switch (snapshot->state) {
+        case PATTERN_STATE_RUNNING:
+            // Same frame and phase as at taken_ms, shown now rather than at
+            // the next update
+            pattern_state = PATTERN_STATE_RUNNING;
+            pattern_player_shift(&pattern_player, now - snapshot->taken_ms);
+            if (pattern_player_update(&pattern_player, now)) {
+                pattern_apply(&pattern_player);
+            }
+#if LED_STREAM_ENABLED
+            stream_pattern_play();
+#endif
             break;
 
-        case PATTERN_RANDOM_TWINKLE:
-            execute_random_twinkle();
+        case PATTERN_STATE_PAUSED:
+            // Resume slides the timeline by the whole time since taken_ms
+            pattern_state = PATTERN_STATE_PAUSED;
+            pause_tick = snapshot->taken_ms;
             break;
 
         default:
-            // Default to solid pattern
-            led_all_on();
+            pattern_manager_stop();
             break;
     }
 }
 
-/* Private functions ---------------------------------------------------------*/
+void pattern_manager_provisional_begin(void) {
+    pattern_manager_snapshot(&provisional);
+    provisional_open = true;
+}
 
-static void execute_solid_pattern(void) {
-    // All LEDs ON
-    led_all_on();
+bool pattern_manager_provisional_pending(void) {
+    return provisional_open;
 }
 
-static void execute_blink_slow(void) {
-    // 1Hz blink (500ms ON, 500ms OFF)
-    if (systick_delay_elapsed(pattern_timer, 500)) {
-        led_all_toggle();
-        pattern_timer = systick_get_ticks();
-    }
+void pattern_manager_provisional_commit(void) {
+    provisional_open = false;
 }
 
-static void execute_blink_fast(void) {
-    // 4Hz blink (125ms ON, 125ms OFF)
-    if (systick_delay_elapsed(pattern_timer, 125)) {
-        led_all_toggle();
-        pattern_timer = systick_get_ticks();
+bool pattern_manager_provisional_rollback(void) {
+    if (!provisional_open) return false;
+    provisional_open = false;
+
+    // Undo as if it never happened: a running pattern catches up with its
+    // own timeline instead of losing the time it was held
+    if (provisional.state == PATTERN_STATE_RUNNING) {
+        provisional.taken_ms = systick_get_ticks();
     }
+    pattern_manager_restore(&provisional);
+    return true;
 }
 
-static void execute_chase_clockwise(void) {
-    if (systick_delay_elapsed(pattern_timer, CHASE_DELAY_MS)) {
-        led_all_off();
+uint32_t pattern_manager_update(void) {
+    uint32_t now = systick_get_ticks();
+    uint32_t deadline = now + PATTERN_IDLE_HORIZON_MS;
+
+    if (pattern_state != PATTERN_STATE_RUNNING) return deadline;
 
-        // Turn on current LED in sequence: Green → Orange → Red → Blue
-        switch (pattern_step) {
-            case 0: led_on(LED_GREEN); break;
-            case 1: led_on(LED_ORANGE); break;
-            case 2: led_on(LED_RED); break;
-            case 3: led_on(LED_BLUE); break;
+#if LED_STREAM_ENABLED
+    // Streamed patterns are clocked by TIM8 + DMA, nothing to do here
+    if (led_stream_is_active()) return deadline;
+#endif
+
+    if (transitioning) {
+        if ((now - transition_start) < transition_ms) {
+            return transition_update(now);
         }
+        transition_end();
+
+#if LED_STREAM_ENABLED
+        if (led_stream_is_active()) return deadline;
+#endif
+    }
 
-        pattern_step = (pattern_step + 1) % 4;
-        pattern_timer = systick_get_ticks();
+    if (pattern_player_update(&pattern_player, now)) {
+        pattern_apply(&pattern_player);
     }
+
+    pattern_player_next_deadline(&pattern_player, &deadline);
+    return deadline;
 }
 
-static void execute_chase_anticlockwise(void) {
-    if (systick_delay_elapsed(pattern_timer, CHASE_DELAY_MS)) {
-        led_all_off();
+/* Private functions ---------------------------------------------------------*/
 
-        // Reverse direction: Blue → Red → Orange → Green
-        switch (pattern_step) {
-            case 0: led_on(LED_BLUE); break;
-            case 1: led_on(LED_RED); break;
-            case 2: led_on(LED_ORANGE); break;
-            case 3: led_on(LED_GREEN); break;
-        }
+/**
+  * @brief  Show the player output on the LEDs.
+  * @note   Full and zero levels are plain on/off writes; anything in between
+  *         goes through led_set_brightness().
+  * @param  player: Player whose output to show.
+  * @retval None
+  */
+static void pattern_apply(const pattern_player_t *player) {
+    led_mask_t mask = player->mask & LED_MASK_ALL;
 
-        pattern_step = (pattern_step + 1) % 4;
-        pattern_timer = systick_get_ticks();
+    if (player->level == PATTERN_LEVEL_FULL || player->level == 0) {
+        led_set_mask((player->level != 0) ? mask : 0);
+        return;
     }
-}
-
-static void execute_knight_rider(void) {
-    if (systick_delay_elapsed(pattern_timer, KNIGHT_RIDER_DELAY_MS)) {
-        static int8_t direction = 1;  // 1 = forward, -1 = backward
 
-        led_all_off();
-        led_on(pattern_step);  // Use LED ID directly (0=Green, 1=Orange, etc.)
+    // Quadratic ramp looks closer to linear to the eye than a linear duty
+    uint16_t level = (uint16_t)(((uint32_t)player->level * player->level * LED_BRIGHTNESS_MAX) /
+                                (PATTERN_LEVEL_FULL * PATTERN_LEVEL_FULL));
 
-        pattern_step += direction;
+    for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
+        led_set_brightness(led, (mask & LED_MASK(led)) ? level : 0);
+    }
+}
 
-        // Reverse direction at ends
-        if (pattern_step == 3 || pattern_step == 0) {
-            direction = -direction;
-        }
+/**
+  * @brief  Show four packed 8-bit levels (byte n = LED n) as PWM brightness.
+  * @param  levels: Packed levels, e.g. from pattern_blend().
+  * @retval None
+  */
+static void pattern_apply_levels(uint32_t levels) {
+    for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
+        uint32_t lane = (levels >> (8U * led)) & 0xFFU;
 
-        pattern_timer = systick_get_ticks();
+        led_set_brightness(led, (uint16_t)((lane * lane * LED_BRIGHTNESS_MAX) /
+                                           (PATTERN_LEVEL_FULL * PATTERN_LEVEL_FULL)));
     }
 }
 
-static void execute_breathe(void) {
-    // Simulated PWM breathing effect
-    uint32_t breathe_interval = BREATHE_CYCLE_MS / 10;  // 10 brightness steps
+/**
+  * @brief  Render one crossfade frame.
+  * @param  now: Current tick, before the end of the fade.
+  * @retval Tick of the next crossfade frame.
+  */
+static uint32_t transition_update(uint32_t now) {
+    uint32_t elapsed = now - transition_start;
+    uint32_t weight = (elapsed * PATTERN_BLEND_ONE) / transition_ms;
 
-    if (systick_delay_elapsed(pattern_timer, breathe_interval)) {
-        // Create breathing pattern by turning LEDs on/off in sequence
-        uint8_t pattern = 0;
+    pattern_player_update(&outgoing_player, now);
+    pattern_player_update(&pattern_player, now);
 
-        if (breathe_direction) {
-            // Brightening: turn on more LEDs
-            for (int i = 0; i <= breathe_step; i++) {
-                pattern |= (1 << i);
-            }
-        } else {
-            // Dimming: turn off LEDs
-            for (int i = breathe_step; i < 4; i++) {
-                pattern |= (1 << i);
-            }
-        }
+    pattern_apply_levels(pattern_blend(pattern_player_levels(&outgoing_player),
+                                       pattern_player_levels(&pattern_player), weight));
 
-        led_set_pattern(pattern);
+    uint32_t deadline = now + PATTERN_RAMP_STEP_MS;
+    uint32_t end = transition_start + transition_ms;
 
-        breathe_step++;
-        if (breathe_step >= 10) {
-            breathe_step = 0;
-            breathe_direction = !breathe_direction;
-        }
+    return SYSTICK_BEFORE(end, deadline) ? end : deadline;
+}
 
-        pattern_timer = systick_get_ticks();
-    }
+/**
+  * @brief  Finish a crossfade and hand the LEDs to the new pattern alone.
+  * @retval None
+  */
+static void transition_end(void) {
+    transitioning = false;
+    pattern_player_stop(&outgoing_player);
+    pattern_player_redraw(&pattern_player);
+
+#if LED_STREAM_ENABLED
+    stream_pattern_play();
+#endif
 }
 
-static void execute_rainbow(void) {
-    // Cycle through color patterns
-    if (systick_delay_elapsed(pattern_timer, 500)) {
-        uint8_t patterns[] = {
-            0b0001,  // Green only
-            0b0011,  // Green + Orange
-            0b0110,  // Orange + Red
-            0b1100,  // Red + Blue
-            0b1001,  // Blue + Green
-            0b0101,  // Green + Red
-            0b1010,  // Orange + Blue
-            0b1111   // All on
-        };
-
-        led_set_pattern(patterns[pattern_step]);
-        pattern_step = (pattern_step + 1) % 8;
-        pattern_timer = systick_get_ticks();
+/**
+  * @brief  Start the current pattern on a timeline beginning at start_ms.
+  * @note   A start tick in the past puts the pattern that far into its
+  *         cycle, so callers chaining deadlines keep the phase too.
+  * @param  start_ms: Tick of phase 0, not after now.
+  * @retval None
+  */
+static void pattern_start_at(uint32_t start_ms) {
+    uint32_t now = systick_get_ticks();
+
+    pattern_state = PATTERN_STATE_RUNNING;
+
+    pattern_player_seed(&pattern_player, pattern_seed_for(current_pattern));
+    pattern_player_set_speed(&pattern_player, pattern_speed, now);
+    pattern_player_start(&pattern_player, &programs[current_pattern], now);
+    if (start_ms != now) {
+        pattern_player_seek(&pattern_player, now - start_ms, now);
     }
+
+#if LED_STREAM_ENABLED
+    stream_pattern_play();
+#endif
 }
 
-static void execute_random_twinkle(void) {
-    if (systick_delay_elapsed(pattern_timer,
-        TWINKLE_MIN_DELAY_MS + (rand() % (TWINKLE_MAX_DELAY_MS - TWINKLE_MIN_DELAY_MS)))) {
+/**
+  * @brief  Pick the random seed for a pattern start.
+  * @note   A fixed seed gives every pattern its own, repeatable sequence.
+  *         Otherwise the hardware RNG is used, falling back to the fixed
+  *         seed if it does not deliver.
+  * @param  pattern: Pattern being started.
+  * @retval Seed value.
+  */
+static uint32_t pattern_seed_for(pattern_t pattern) {
+#if RNG_HW_ENABLED
+    uint32_t seed;
 
-        // Turn off all LEDs
-        led_all_off();
+    if (!seed_fixed && hw_rng_read(&seed)) return seed;
+#endif
+    return pattern_seed ^ ((uint32_t)(pattern + 1) * SEED_SPREAD);
+}
 
-        // Randomly light 1-2 LEDs
-        uint8_t num_leds = 1 + (rand() % 2);
-        for (uint8_t i = 0; i < num_leds; i++) {
-            led_id_t random_led = rand() % LED_COUNT;
-            led_on(random_led);
-        }
+#if LED_STREAM_ENABLED
 
-        pattern_timer = systick_get_ticks();
+/**
+  * @brief  Look up the program of a pattern if the DMA stream can play it.
+  * @param  pattern: Pattern to look up.
+  * @retval Program, or NULL if the pattern needs the keyframe player.
+  */
+static const pattern_program_t *stream_program_for(pattern_t pattern) {
+    const pattern_program_t *program = &programs[pattern];
+
+    return pattern_program_is_streamable(program) ? program : 0;
+}
+
+/**
+  * @brief  Start streaming the current program from the frame the timeline
+  *         is on.
+  * @note   The cycle is written rotated so the circular DMA can start mid-way,
+  *         and the frame timer starts partway into the current frame. The
+  *         timeline is left alone, so restarts never lose phase.
+  * @retval None
+  */
+static void stream_pattern_play(void) {
+    if (stream_program == 0 || pattern_state != PATTERN_STATE_RUNNING || transitioning) return;
+
+    uint32_t now = systick_get_ticks();
+    uint32_t frame_ms = pattern_player_frame_ms(&pattern_player, stream_program, 0);
+    uint8_t count = stream_program->frame_count;
+    uint32_t phase = pattern_player_phase(&pattern_player, now);
+    uint8_t first = (uint8_t)((phase / frame_ms) % count);
+
+    if (first == 0 && current_pattern == stream_cued) {
+        // Cycle start of the cued pattern: its words are already in the spare row
+        stream_buffer ^= 1U;
+        stream_cued = PATTERN_COUNT;
+    } else {
+        uint32_t *words = stream_words[stream_buffer];
+
+        for (uint8_t i = 0; i < count; i++) {
+            words[i] = led_stream_word(stream_program->frames[(first + i) % count].mask);
+        }
     }
+
+    led_stream_play(stream_words[stream_buffer], count, frame_ms * 1000U, (phase % frame_ms) * 1000U);
 }
 
+/**
+  * @brief  Stop the stream; the timeline keeps its position.
+  * @retval None
+  */
+static void stream_pattern_halt(void) {
+    if (stream_program == 0 || !led_stream_is_active()) return;
+
+    led_stream_stop();
+}
+
+#endif /* LED_STREAM_ENABLED */
+
 /******************************** END OF FILE *********************************/
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    playlist.c
+  * @brief   Pattern playlist sequencer implementation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "playlist.h"
+#include "pattern_engine.h"
+#include "systick.h"
+
+/* Private typedef -----------------------------------------------------------*/
+
+/**
+  * @brief  Playlist control structure.
+  */
+typedef struct {
+    const playlist_entry_t *entries;    /*!< Entry table, NULL if none */
+    uint8_t count;                      /*!< Number of entries */
+    uint8_t index;                      /*!< Entry playing */
+    uint8_t pass;                       /*!< Play of that entry, from 1 */
+    uint8_t next_index;                 /*!< Preloaded: entry due at entry_end */
+    uint8_t next_pass;                  /*!< Preloaded: its play number */
+    bool loop;                          /*!< Wrap around after the last entry */
+    bool active;                        /*!< Entries are being advanced */
+    bool has_next;                      /*!< Something follows the current play */
+    bool timed;                         /*!< entry_end is a real deadline */
+    bool held;                          /*!< Pattern not running, clock frozen */
+    bool speed_saved;                   /*!< saved_speed is to be restored */
+    uint16_t saved_speed;               /*!< Pattern speed before the playlist */
+    uint32_t duration;                  /*!< Length of the current play, 0 if untimed */
+    uint32_t next_duration;             /*!< Preloaded: length of the next play */
+    uint32_t entry_end;                 /*!< Tick the current play ends */
+    uint32_t held_since;                /*!< Tick the hold began */
+} playlist_ctrl_t;
+
+/* Private variables ---------------------------------------------------------*/
+static playlist_ctrl_t pl = {0};
+
+/* Private function prototypes -----------------------------------------------*/
+static void playlist_enter(uint8_t index, uint8_t pass, uint32_t start_ms, uint32_t duration);
+static void playlist_preload(void);
+static uint32_t playlist_cue(uint8_t index);
+
+/* Exported functions --------------------------------------------------------*/
+
+void playlist_start(const playlist_entry_t *entries, uint8_t count, bool loop) {
+    pl.active = false;
+    if (entries == 0 || count == 0) return;
+
+    // A playlist replacing another keeps the speed from before the first
+    if (!pl.speed_saved) {
+        pl.saved_speed = pattern_manager_get_speed();
+        pl.speed_saved = true;
+    }
+
+    pl.entries = entries;
+    pl.count = count;
+    pl.loop = loop;
+    pl.held = false;
+    pl.active = true;
+
+    playlist_enter(0, 1, systick_get_ticks(), playlist_cue(0));
+}
+
+void playlist_stop(void) {
+    pl.active = false;
+
+    if (pl.speed_saved) {
+        pl.speed_saved = false;
+        pattern_manager_set_speed(pl.saved_speed);
+    }
+}
+
+void playlist_next(void) {
+    if (!pl.active) return;
+
+    uint8_t index = pl.index + 1U;
+
+    if (index >= pl.count) {
+        if (!pl.loop) return;   // Stay on the last entry
+        index = 0;
+    }
+
+    pl.held = false;
+    playlist_enter(index, 1, systick_get_ticks(), playlist_cue(index));
+}
+
+bool playlist_is_active(void) {
+    return pl.active;
+}
+
+uint8_t playlist_get_index(void) {
+    return pl.index;
+}
+
+uint32_t playlist_update(void) {
+    uint32_t now = systick_get_ticks();
+    uint32_t deadline = now + PATTERN_IDLE_HORIZON_MS;
+
+    if (!pl.active) return deadline;
+
+    // Paused (or asleep): the entry keeps its remaining time
+    if (pattern_manager_get_state() != PATTERN_STATE_RUNNING) {
+        if (!pl.held) {
+            pl.held = true;
+            pl.held_since = now;
+        }
+        return deadline;
+    }
+    if (pl.held) {
+        pl.entry_end += now - pl.held_since;
+        pl.held = false;
+    }
+
+    if (!pl.timed) return deadline;
+    if (SYSTICK_BEFORE(now, pl.entry_end)) return pl.entry_end;
+
+    if (!pl.has_next) {
+        pl.active = false;
+        return deadline;
+    }
+
+    // Chain from the deadline rather than now, so entry lengths do not drift
+    playlist_enter(pl.next_index, pl.next_pass, pl.entry_end, pl.next_duration);
+
+    return pl.timed ? pl.entry_end : deadline;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Start one play of an entry.
+  * @param  index: Entry to play.
+  * @param  pass: Play number of the entry, from 1.
+  * @param  start_ms: Tick the play starts at.
+  * @param  duration: Length of the play from playlist_cue(), 0 if untimed.
+  * @retval None
+  */
+static void playlist_enter(uint8_t index, uint8_t pass, uint32_t start_ms, uint32_t duration) {
+    const playlist_entry_t *entry = &pl.entries[index];
+
+    // The pattern's timeline starts at start_ms like the deadline, so
+    // switching late does not shift its phase
+    if (pass > 1U) {
+        // Repeat: same pattern and speed, back to the start of its cycle
+        pattern_manager_seek(systick_get_ticks() - start_ms);
+    } else {
+        // Pattern and speed together, so the stream starts once
+        pattern_manager_play(entry->pattern, entry->speed, start_ms);
+    }
+
+    pl.index = index;
+    pl.pass = pass;
+    pl.duration = duration;
+    pl.timed = (duration != 0);
+    pl.entry_end = start_ms + duration;
+
+    playlist_preload();
+}
+
+/**
+  * @brief  Resolve what plays when the current play ends.
+  * @note   Done on entry, so the deadline itself only switches: the next
+  *         pattern's stream words and play length are ready by then.
+  * @retval None
+  */
+static void playlist_preload(void) {
+    const playlist_entry_t *entry = &pl.entries[pl.index];
+    uint8_t plays = (entry->repeat != 0) ? entry->repeat : 1U;
+
+    pl.has_next = true;
+
+    if (pl.pass < plays) {
+        pl.next_index = pl.index;
+        pl.next_pass = pl.pass + 1U;
+        pl.next_duration = pl.duration;
+        return;
+    }
+
+    pl.next_pass = 1;
+    pl.next_index = pl.index + 1U;
+    if (pl.next_index >= pl.count) {
+        pl.next_index = 0;
+        pl.has_next = pl.loop;
+    }
+    if (pl.has_next) {
+        pl.next_duration = playlist_cue(pl.next_index);
+    }
+}
+
+/**
+  * @brief  Cue an entry's pattern with the pattern manager.
+  * @param  index: Entry to cue.
+  * @retval Length of one play of the entry, 0 if untimed.
+  */
+static uint32_t playlist_cue(uint8_t index) {
+    const playlist_entry_t *entry = &pl.entries[index];
+    uint32_t cycle_ms = pattern_manager_cue(entry->pattern, entry->speed);
+
+    return (entry->duration_ms != 0) ? entry->duration_ms : cycle_ms;
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    prng.c
+  * @brief   Small seedable pseudo-random number generator implementation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "prng.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PRNG_ZERO_SEED      0x9E3779B9UL    /* Used in place of a 0 seed */
+
+/* Exported functions --------------------------------------------------------*/
+
+void prng_seed(prng_t *rng, uint32_t seed) {
+    rng->state = (seed != 0) ? seed : PRNG_ZERO_SEED;
+}
+
+uint32_t prng_next(prng_t *rng) {
+    uint32_t x = rng->state;
+
+    // Marsaglia xorshift32 (13, 17, 5), period 2^32 - 1
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    rng->state = x;
+    return x;
+}
+
+uint32_t prng_range(prng_t *rng, uint32_t n) {
+    return (uint32_t)(((uint64_t)prng_next(rng) * n) >> 32);
+}
+
+/******************************** END OF FILE *********************************/
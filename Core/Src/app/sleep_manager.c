@@ -9,14 +9,15 @@
 #include "sleep_manager.h"
 #include "led.h"
 #include "button.h"
+#include "pattern_manager.h"
 #include "systick.h"
+#include "exti.h"
 #include "stm32f4xx.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private define ------------------------------------------------------------*/
-#define WAKEUP_PIN          GPIO_PIN_0      /* PA0 - User button */
-#define WAKEUP_EXTI_LINE    EXTI_Line0
+#define WAKEUP_EXTI_LINE    0U              /* EXTI line = pin number */
 #define ENTER_SLEEP_DELAY_MS 1000           /* Time to show sleep animation */
 
 /* Private macro -------------------------------------------------------------*/
@@ -24,16 +25,11 @@
 /* Private variables ---------------------------------------------------------*/
 static sleep_state_t sleep_state = SLEEP_STATE_AWAKE;
 static sleep_mode_t sleep_mode = SLEEP_MODE_STOP;
-static uint32_t sleep_enter_time = 0;
 static bool wakeup_requested = false;
 
-/* Pattern state to restore after wakeup
-static struct {
-    uint8_t pattern_id;
-    uint32_t pattern_step;
-    uint32_t pattern_timer;
-} saved_pattern_state;
-*/
+/* Pattern state to restore after wakeup */
+static pattern_snapshot_t saved_pattern_state;
+
 /* Private function prototypes -----------------------------------------------*/
 static void enter_sleep_mode(void);
 static void enter_stop_mode(void);
@@ -42,6 +38,7 @@ static void save_system_state(void);
 static void restore_system_state(void);
 static void sleep_indication_enter(void);
 static void sleep_indication_exit(void);
+static void wakeup_callback(uint8_t line);
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -53,8 +50,13 @@ void sleep_manager_init(void) {
     // Enable PWR clock (required for low-power modes)
     RCC->APB1ENR |= RCC_APB1ENR_PWREN;
 
+#if !BUTTON_CAPTURE_ENABLED
     // Configure wakeup source (PA0 button)
     configure_wakeup_source();
+#endif
+
+    // Registered after the button driver, so it sees the wake press first
+    exti_register(WAKEUP_EXTI_LINE, wakeup_callback);
 }
 
 void sleep_manager_enter(void) {
@@ -62,12 +64,14 @@ void sleep_manager_enter(void) {
 
     sleep_state = SLEEP_STATE_ENTERING;
 
-    // 1. Visual indication: Entering sleep
-    sleep_indication_enter();
-
-    // 2. Save current system state
+    // 1. Save current system state (freezes the pattern, so DMA-streamed
+    //    frames stop driving the LEDs)
     save_system_state();
 
+    // 2. Visual indication: Entering sleep
+    sleep_indication_enter();
+    led_all_off();
+
     // 3. Configure for low-power
     // Disable systick interrupt during sleep
     SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
@@ -76,27 +80,33 @@ void sleep_manager_enter(void) {
     // RCC->CFGR &= ~RCC_CFGR_HPRE;  // Set AHB prescaler to 1
 
     // 4. Enter sleep mode
+#if BUTTON_CAPTURE_ENABLED
+    // The capture backend leaves EXTI0 alone: it is armed only to wake
+    configure_wakeup_source();
+#endif
     enter_sleep_mode();
+#if BUTTON_CAPTURE_ENABLED
+    exti_disable(WAKEUP_EXTI_LINE);
+#endif
 
     // 5. After wakeup (code continues here)
     sleep_state = SLEEP_STATE_WAKING;
 
-    // 6. Restore system
-    // Re-enable systick
+    // 6. Re-enable systick
     SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
 
-    // Restore system state
-    restore_system_state();
-
     // 7. Visual indication: Waking up
     sleep_indication_exit();
 
+    // 8. Restore system state: the pattern continues on the frozen frame
+    restore_system_state();
+
     sleep_state = SLEEP_STATE_AWAKE;
     wakeup_requested = false;
 }
 
 void sleep_manager_wake(void) {
-    // This function is called from EXTI interrupt handler
+    // Called from the EXTI wake-up callback
     wakeup_requested = true;
 }
 
@@ -178,46 +188,33 @@ static void enter_stop_mode(void) {
 }
 
 static void configure_wakeup_source(void) {
-    // PA0 is already configured as EXTI by button driver
-    // Ensure rising edge is enabled for wakeup
-    EXTI->RTSR |= EXTI_RTSR_TR0;  // Rising edge (button press)
-
-    // For Stop mode, need to unmask EXTI line
-    EXTI->IMR |= EXTI_IMR_MR0;
-
-    // Clear any pending EXTI interrupt
-    if (EXTI->PR & EXTI_PR_PR0) {
-        EXTI->PR = EXTI_PR_PR0;
-    }
+#if BUTTON_CAPTURE_ENABLED
+    // The line is ours alone while asleep: only the press (rising edge)
+    exti_configure(BUTTON_GPIO_PORT, WAKEUP_EXTI_LINE, EXTI_TRIGGER_RISING);
+#else
+    // Same edges as the button driver uses, so its callback keeps working;
+    // the press (rising edge) is the one that wakes
+    exti_configure(BUTTON_GPIO_PORT, WAKEUP_EXTI_LINE, EXTI_TRIGGER_BOTH);
+#endif
+
+    // For Stop mode, need to unmask EXTI line (clears anything pending)
+    exti_enable(WAKEUP_EXTI_LINE, EXTI_PRIORITY);
 
     // For Standby mode (if using):
     // PWR->CSR |= PWR_CSR_EWUP;  // Enable WKUP pin
 }
 
 static void save_system_state(void) {
-    // Save pattern manager state (if you have access)
-    // In a real implementation, you'd save:
-    // - Current pattern ID
-    // - Pattern step counter
-    // - Pattern timer value
-    // - LED states
-
-    // For now, just save timestamp
-    sleep_enter_time = systick_get_ticks();
-
-    // Turn off all LEDs
-    led_all_off();
+    // Pattern, frame, timeline phase and player state; the pattern is then
+    // paused so nothing drives the LEDs until restore
+    pattern_manager_snapshot(&saved_pattern_state);
+    pattern_manager_pause();
 }
 
 static void restore_system_state(void) {
-    // Restore system to previous state
-    // In a real implementation, you'd restore saved state
-
-    // Re-initialize critical peripherals if needed
-    // systick_init();  // Already running
-
-    // Small delay to allow system to stabilize
-    for (volatile uint32_t i = 0; i < 1000; i++);
+    // The snapshot skips the time spent in the sleep animations, so the
+    // pattern redraws at once on the frame it was saved on
+    pattern_manager_restore(&saved_pattern_state);
 }
 
 static void sleep_indication_enter(void) {
@@ -280,4 +277,14 @@ static void sleep_indication_exit(void) {
     led_all_off();
 }
 
+static void wakeup_callback(uint8_t line) {
+    (void)line;
+
+    if (sleep_state != SLEEP_STATE_SLEEPING) return;
+
+    // The press that wakes the board is not a gesture
+    button_suppress(BUTTON_USER);
+    sleep_manager_wake();
+}
+
 /******************************** END OF FILE *********************************/
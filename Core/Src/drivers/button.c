@@ -7,82 +7,140 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "button.h"
+#include "button_scan.h"
+#include "button_capture.h"
+#include "button_oneshot.h"
+#include "gesture.h"
 #include "board_config.h"
 #include "systick.h"
+#include "exti.h"
 #include "stm32f4xx.h"
 
-extern void sleep_manager_wake(void);
-extern bool sleep_manager_is_sleeping(void);
+/* Private define ------------------------------------------------------------*/
+#define EVENT_QUEUE_MASK    (BUTTON_EVENT_QUEUE_SIZE - 1U)
+#define BUTTON_BIT(id)      (1UL << (id))
+#define US_PER_MS           1000U
 
-/* Private typedef -----------------------------------------------------------*/
+#if (BUTTON_EVENT_QUEUE_SIZE & EVENT_QUEUE_MASK) != 0
+#error "BUTTON_EVENT_QUEUE_SIZE must be a power of two"
+#endif
 
-/**
-  * @brief  Button state machine states.
-  */
-typedef enum {
-    BTN_STATE_IDLE = 0,
-    BTN_STATE_DEBOUNCING,
-    BTN_STATE_PRESSED,
-    BTN_STATE_RELEASED,
-    BTN_STATE_LONG_PRESS
-} button_state_t;
+#if BUTTON_COUNT > 32
+#error "Button masks hold at most 32 buttons"
+#endif
 
-/**
-  * @brief  Button control structure.
-  */
-typedef struct {
-    button_state_t state;           /*!< Current state */
-    bool last_raw_state;            /*!< Last GPIO reading */
-    uint32_t state_enter_time;      /*!< When we entered current state */
-    uint32_t press_start_time;      /*!< When button was first pressed */
-    button_event_t pending_event;   /*!< Event to return */
-    bool click_pending;             /*!< First click detected */
-} button_ctrl_t;
+#if BUTTON_CAPTURE_ENABLED && BUTTON_ONESHOT_ENABLED
+#error "Choose one user button backend: capture or one-shot"
+#endif
+
+/* The user button is scanned unless a backend of its own times it */
+#define USER_BUTTON_SCANNED (!BUTTON_CAPTURE_ENABLED && !BUTTON_ONESHOT_ENABLED)
 
 /* Private variables ---------------------------------------------------------*/
-static button_ctrl_t btn = {0};
+static GPIO_TypeDef *const button_ports[BUTTON_PORT_COUNT] = BUTTON_PORT_TABLE;
+static const button_desc_t button_desc[BUTTON_COUNT] = BUTTON_DESCRIPTOR_TABLE;
+
+/* Whole-port debouncing: one vertical counter per port, lane = pin */
+static button_scan_t port_scan[BUTTON_PORT_COUNT];
+static uint16_t port_mask[BUTTON_PORT_COUNT];       /*!< Pins that are buttons */
+static uint16_t port_invert[BUTTON_PORT_COUNT];     /*!< Active-low pins */
+static uint8_t pin_button[BUTTON_PORT_COUNT][16];   /*!< Pin -> button_id_t */
+static uint8_t scan_divider = 0;
+
+/* Edge state, bit n = button_id_t n; only touched at SysTick priority */
+static volatile uint32_t held = 0;                  /*!< Debounced pressed */
+static volatile uint32_t swallow = 0;               /*!< Presses not for gestures */
+static uint32_t swallow_us = 0;                     /*!< When swallow was last set */
+#if BUTTON_EAGER_ENABLED
+static uint32_t provisional = 0;                    /*!< Press reported, unconfirmed */
+static uint32_t provisional_us = 0;
+#endif
+
+/* Event ring: head is only written by the producer, tail only by the
+   consumer. Both run freely and are masked on access. */
+static button_event_record_t event_ring[BUTTON_EVENT_QUEUE_SIZE];
+static volatile uint32_t event_head = 0;
+static volatile uint32_t event_tail = 0;
+static volatile uint32_t event_dropped = 0;
 
 /* Private function prototypes -----------------------------------------------*/
-static void process_idle_state(void);
-static void process_debouncing_state(void);
-static void process_pressed_state(void);
-static void process_released_state(void);
-static void handle_press_detected(void);
-static void handle_release_detected(void);
+static uint32_t port_sample(uint8_t port);
+#if !BUTTON_CAPTURE_ENABLED
+static void button_exti_callback(uint8_t line);
+#endif
+static void event_push(button_id_t button, button_event_t event, uint8_t count, uint32_t timestamp);
 
 /* Exported functions --------------------------------------------------------*/
 
 void button_init(void) {
-    /* 1. Enable GPIOA clock */
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    /* 1. Enable GPIO clocks */
+    BUTTON_GPIO_CLK_ENABLE();
+
+    /* 2. Configure every button as input without pull, build the scan map */
+    for (uint8_t p = 0; p < BUTTON_PORT_COUNT; p++) {
+        port_mask[p] = 0;
+        port_invert[p] = 0;
+    }
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        const button_desc_t *desc = &button_desc[i];
+        GPIO_TypeDef *port = button_ports[desc->port];
+
+#if !USER_BUTTON_SCANNED
+        if (i == BUTTON_USER) continue;     /* Timed by its own backend */
+#endif
 
-    /* 2. Configure PA0 as input with pull-up */
-    GPIOA->MODER &= ~GPIO_MODER_MODER0;     /* Input mode */
-    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR0;     /* Clear pull settings */
+        port->MODER &= ~(3UL << (desc->pin * 2U));      /* Input mode */
+        port->PUPDR &= ~(3UL << (desc->pin * 2U));      /* Clear pull settings */
 
+        port_mask[desc->port] |= (uint16_t)(1U << desc->pin);
+        if (desc->polarity == BUTTON_ACTIVE_LOW) {
+            port_invert[desc->port] |= (uint16_t)(1U << desc->pin);
+        }
+        pin_button[desc->port][desc->pin] = i;
+    }
+
+#if !BUTTON_CAPTURE_ENABLED
+    /* 3. Route PA0 to EXTI0, both edges (the capture backend needs none) */
+    exti_configure(GPIOA, BUTTON_GPIO_PIN_NUM, EXTI_TRIGGER_BOTH);
+
+    /* 4. Register with the EXTI dispatcher */
+    exti_register(BUTTON_GPIO_PIN_NUM, button_exti_callback);
 
-    /* 3. Enable SYSCFG clock for EXTI */
-    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    /* 5. Unmask the line and enable its vector */
+    exti_enable(BUTTON_GPIO_PIN_NUM, EXTI_PRIORITY);
+#endif
 
-    /* 4. Connect PA0 to EXTI0 */
-    SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI0;
-    SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI0_PA;
+    /* 6. The gesture recognizer reports into the event ring */
+    gesture_init(event_push);
 
-    /* 5. Configure EXTI line 0 */
-    EXTI->IMR |= EXTI_IMR_MR0;      /* Unmask EXTI0 */
-    EXTI->FTSR |= EXTI_FTSR_TR0;    /* Falling edge trigger (release) */
-    EXTI->RTSR |= EXTI_RTSR_TR0;    /* Rising edge trigger (press) */
+    /* 7. Start from the current levels, without reporting them as edges */
+    held = 0;
+    for (uint8_t p = 0; p < BUTTON_PORT_COUNT; p++) {
+        button_scan_reset(&port_scan[p], port_sample(p));
+    }
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        if (port_scan[button_desc[i].port].state & (1UL << button_desc[i].pin)) {
+            held |= BUTTON_BIT(i);
+        }
+    }
 
-    /* 6. Enable EXTI0 interrupt in NVIC */
-    NVIC_SetPriority(EXTI0_IRQn, 0);
-    NVIC_EnableIRQ(EXTI0_IRQn);
+#if BUTTON_CAPTURE_ENABLED
+    /* 8. User button edges from TIM5 input capture */
+    button_capture_init();
+#elif BUTTON_ONESHOT_ENABLED
+    /* 8. User button edges from EXTI0, settled by the TIM6 one-shot */
+    button_oneshot_init();
+#endif
+#if !USER_BUTTON_SCANNED
+    if (button_is_pressed_raw()) {
+        held |= BUTTON_BIT(BUTTON_USER);
+    }
+#endif
 
-    /* 7. Initialize control structure */
-    btn.state = BTN_STATE_IDLE;
-    btn.last_raw_state = button_is_pressed_raw();
-    btn.state_enter_time = systick_get_ticks();
-    btn.pending_event = BUTTON_EVENT_NONE;
-    btn.click_pending = false;
+    swallow = held;     /* Already down: no gestures until released */
+
+    event_tail = event_head;
+    event_dropped = 0;
 }
 
 bool button_is_pressed_raw(void) {
@@ -91,157 +149,205 @@ bool button_is_pressed_raw(void) {
 }
 
 bool button_is_pressed(void) {
-    return (btn.state == BTN_STATE_PRESSED || btn.state == BTN_STATE_LONG_PRESS);
+    return (held & BUTTON_BIT(BUTTON_USER)) != 0;
+}
+
+bool button_is_idle(void) {
+    return event_head == event_tail;
 }
 
 button_event_t button_get_event(void) {
-    button_event_t event = btn.pending_event;
-    btn.pending_event = BUTTON_EVENT_NONE;
-    return event;
+    button_event_record_t record;
+
+    if (button_read_events(&record, 1) == 0) return BUTTON_EVENT_NONE;
+    return (button_event_t)record.event;
 }
 
-void button_update(void) {
-    uint32_t current_time = systick_get_ticks();
+uint8_t button_read_events(button_event_record_t *records, uint8_t max) {
+    uint32_t tail = event_tail;
+    uint32_t count = event_head - tail;
 
-    switch (btn.state) {
-        case BTN_STATE_IDLE:
-            process_idle_state();
-            break;
+    // Read the records only after seeing the head that published them
+    __DMB();
 
-        case BTN_STATE_DEBOUNCING:
-            process_debouncing_state();
-            break;
+    if (count > max) count = max;
+    for (uint32_t i = 0; i < count; i++) {
+        records[i] = event_ring[(tail + i) & EVENT_QUEUE_MASK];
+    }
 
-        case BTN_STATE_PRESSED:
-            process_pressed_state();
-            break;
+    // Finish reading before handing the slots back to the producer
+    __DMB();
+    event_tail = tail + count;
 
-        case BTN_STATE_RELEASED:
-            process_released_state();
-            break;
+    return (uint8_t)count;
+}
 
-        case BTN_STATE_LONG_PRESS:
-            /* Stay in long press until button is released */
-            if (!button_is_pressed_raw()) {
-                btn.state = BTN_STATE_DEBOUNCING;
-                btn.state_enter_time = current_time;
-            }
-            break;
-    }
+uint32_t button_get_dropped_events(void) {
+    return event_dropped;
+}
 
-    /* Check for double-click timeout */
-    if (btn.click_pending) {
-        if (current_time - btn.state_enter_time >= DOUBLE_CLICK_MAX_MS) {
-            /* Timeout - it was just a single click */
-            btn.click_pending = false;
-        }
-    }
+uint32_t button_now_us(void) {
+#if BUTTON_CAPTURE_ENABLED
+    return button_capture_now_us();
+#else
+    return systick_get_ticks() * US_PER_MS;
+#endif
 }
 
-void button_exti_handler(void) {
-    /* Check if EXTI0 triggered */
-    if (EXTI->PR & EXTI_PR_PR0) {
-        /* Clear pending bit */
-        EXTI->PR = EXTI_PR_PR0;
-        // Check if we're waking from sleep
-        if (sleep_manager_is_sleeping()) {
-            // Wake up the system
-            sleep_manager_wake();
-            return;  // Skip normal button processing
-        }
+void button_edge(button_id_t button, bool pressed, uint32_t time_us) {
+    uint32_t bit = BUTTON_BIT(button);
 
-        /* Update button state based on interrupt */
-        bool pressed = button_is_pressed_raw();
+    if (pressed) {
+        held |= bit;
+    } else {
+        held &= ~bit;
+    }
 
-        if (pressed && btn.state == BTN_STATE_IDLE) {
-            /* Press detected - start de-bouncing */
-            btn.state = BTN_STATE_DEBOUNCING;
-            btn.state_enter_time = systick_get_ticks();
-            btn.press_start_time = btn.state_enter_time;
-        }
-        else if (!pressed && (btn.state == BTN_STATE_PRESSED ||
-                              btn.state == BTN_STATE_LONG_PRESS)) {
-            /* Release detected - start de-bouncing */
-            btn.state = BTN_STATE_DEBOUNCING;
-            btn.state_enter_time = systick_get_ticks();
-        }
+    if (swallow & bit) {
+        /* Swallow the whole press, release included */
+        if (!pressed) swallow &= ~bit;
+        return;
     }
+#if BUTTON_EAGER_ENABLED
+    if (pressed) {
+        provisional &= ~bit;    /* The PRESSED that follows confirms it */
+    }
+#endif
+    gesture_edge(button, pressed, time_us);
 }
 
-/* Private functions ---------------------------------------------------------*/
+void button_tick(void) {
+    if (++scan_divider < BUTTON_SCAN_PERIOD_MS) return;
+    scan_divider = 0;
 
-static void process_idle_state(void) {
-    /* Nothing to do in idle state */
-}
+    uint32_t now_us = button_now_us();
 
-static void process_debouncing_state(void) {
-    uint32_t current_time = systick_get_ticks();
-
-    /* Wait for de-bounce time to pass */
-    if (current_time - btn.state_enter_time >= DEBOUNCE_TIME_MS) {
-        bool pressed = button_is_pressed_raw();
-
-        if (pressed) {
-            /* Press is stable */
-            btn.state = BTN_STATE_PRESSED;
-            handle_press_detected();
-        } else {
-            /* Release is stable */
-            btn.state = BTN_STATE_RELEASED;
-            handle_release_detected();
-        }
+    // One read and one vertical-counter step per port, then work only on
+    // the lanes that actually flipped
+    for (uint8_t p = 0; p < BUTTON_PORT_COUNT; p++) {
+        if (port_mask[p] == 0) continue;    /* Nothing left to scan here */
 
-        btn.state_enter_time = current_time;
+        uint32_t toggled = button_scan_step(&port_scan[p], port_sample(p));
+
+        while (toggled) {
+            uint8_t pin = BUTTON_LOWEST_BIT(toggled);
+            button_id_t button = (button_id_t)pin_button[p][pin];
+
+            toggled &= toggled - 1U;
+            button_edge(button, (port_scan[p].state & (1UL << pin)) != 0, now_us);
+        }
     }
-}
 
-static void process_pressed_state(void) {
-    uint32_t current_time = systick_get_ticks();
-    uint32_t press_duration = current_time - btn.press_start_time;
+    gesture_tick(now_us);
 
-    /* Check for long press */
-    if (press_duration >= LONG_PRESS_TIME_MS) {
-        btn.state = BTN_STATE_LONG_PRESS;
-        btn.pending_event = BUTTON_EVENT_LONG_PRESS;
-        btn.state_enter_time = current_time;
+    // A wake press too short to be seen by a scan must not eat the next one
+    if ((swallow & ~held) && now_us - swallow_us >= DEBOUNCE_TIME_MS * 2U * US_PER_MS) {
+        swallow &= held;
     }
 
-    /* Check if button was released (via polling) */
-    if (!button_is_pressed_raw()) {
-        btn.state = BTN_STATE_DEBOUNCING;
-        btn.state_enter_time = current_time;
+#if BUTTON_EAGER_ENABLED
+    // An eager press that debouncing never confirmed was a glitch
+    if (provisional && now_us - provisional_us >= BUTTON_EAGER_CONFIRM_MS * US_PER_MS) {
+        provisional = 0;
+        event_push(BUTTON_USER, BUTTON_EVENT_PRESS_RETRACTED, 0, now_us);
     }
+#endif
 }
 
-static void process_released_state(void) {
-    /* Release processing complete */
-    btn.state = BTN_STATE_IDLE;
+void button_get_debounce(button_id_t button, button_debounce_t *info) {
+#if BUTTON_CAPTURE_ENABLED
+    if (button == BUTTON_USER) {
+        button_capture_get_debounce(info);
+        return;
+    }
+#elif BUTTON_ONESHOT_ENABLED
+    if (button == BUTTON_USER) {
+        info->window_us = BUTTON_ONESHOT_SETTLE_MS * US_PER_MS;
+    } else
+#endif
+    {
+        info->window_us = BUTTON_SCAN_PERIOD_MS * BUTTON_SCAN_SAMPLES * US_PER_MS;
+    }
+    (void)button;
+    info->bounce_us = 0;
+    info->last_bounce_us = 0;
+    info->samples = 0;
 }
 
-static void handle_press_detected(void) {
-    btn.pending_event = BUTTON_EVENT_PRESSED;
+void button_suppress(button_id_t button) {
+    swallow |= BUTTON_BIT(button);
+    swallow_us = button_now_us();
 }
 
-static void handle_release_detected(void) {
-    uint32_t press_duration = systick_get_ticks() - btn.press_start_time;
-
-    if (press_duration < LONG_PRESS_TIME_MS) {
-        /* It was a short press */
-        if (btn.click_pending) {
-            /* Second click within time window = double click */
-            btn.pending_event = BUTTON_EVENT_DOUBLE_CLICK;
-            btn.click_pending = false;
-        } else {
-            /* First click - could be start of double click */
-            btn.pending_event = BUTTON_EVENT_RELEASED;
-            btn.click_pending = true;
-            btn.state_enter_time = systick_get_ticks();
-        }
-    } else {
-        /* It was a long press (already handled) */
-        btn.pending_event = BUTTON_EVENT_RELEASED;
-        btn.click_pending = false;
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Read the buttons of one port, 1 = pressed.
+  * @param  port: Index into BUTTON_PORT_TABLE.
+  * @retval Pressed pins of the port.
+  */
+static uint32_t port_sample(uint8_t port) {
+    return (button_ports[port]->IDR ^ port_invert[port]) & port_mask[port];
+}
+
+/**
+  * @brief  EXTI0 callback (PA0 edge), run from PendSV.
+  * @param  line: EXTI line.
+  * @retval None
+  */
+#if !BUTTON_CAPTURE_ENABLED
+static void button_exti_callback(uint8_t line) {
+    (void)line;
+
+#if BUTTON_EAGER_ENABLED
+    if (button_is_pressed_raw() &&
+        !((held | swallow | provisional) & BUTTON_BIT(BUTTON_USER))) {
+        /* First edge of a press: report it now, debouncing decides later */
+        provisional |= BUTTON_BIT(BUTTON_USER);
+        provisional_us = button_now_us();
+        event_push(BUTTON_USER, BUTTON_EVENT_PRESS_PROVISIONAL, 0, provisional_us);
     }
+#endif
+
+#if BUTTON_ONESHOT_ENABLED
+    /* Settle, then sample once; EXTI0 stays masked meanwhile */
+    button_oneshot_edge();
+#endif
+
+    /* Otherwise edges are picked up by the next scan */
+}
+#endif
+
+/**
+  * @brief  Queue an event for the application.
+  * @note   Single producer priority, safe from interrupt context: every
+  *         caller runs at SysTick priority (PendSV and the button timers
+  *         share it), and the record is complete before the head moves
+  *         past it. A full queue counts the
+  *         event as dropped instead of overwriting an unread one.
+  * @param  button: Button the event belongs to.
+  * @param  event: Event to queue.
+  * @param  count: Event-specific count.
+  * @param  timestamp: Button clock at the event.
+  * @retval None
+  */
+static void event_push(button_id_t button, button_event_t event, uint8_t count, uint32_t timestamp) {
+    uint32_t head = event_head;
+
+    if (head - event_tail >= BUTTON_EVENT_QUEUE_SIZE) {
+        event_dropped++;
+        return;
+    }
+
+    button_event_record_t *record = &event_ring[head & EVENT_QUEUE_MASK];
+    record->timestamp_us = timestamp;
+    record->event = (uint8_t)event;
+    record->button = (uint8_t)button;
+    record->count = count;
+
+    // Publish only once the record is written
+    __DMB();
+    event_head = head + 1U;
 }
 
 /******************************** END OF FILE *********************************/
@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file    button_capture.c
+  * @brief   Input-capture button backend implementation.
+  *
+  *          TI1 (PA0) feeds two captures through the same filter: CC1 on the
+  *          rising edge (press, the button is active-high) and CC2, mapped
+  *          to TI1, on the falling edge. Only the channel that changes the
+  *          reported level interrupts, so the direction of an edge is the
+  *          channel that caught it.
+  *
+  *          A reported edge starts a lockout: capture interrupts go off and
+  *          CC3 is armed as a compare at edge + lockout. Both captures keep
+  *          running, so when it fires CCR1 and CCR2 hold the last edge each
+  *          way. Whichever is later is the level the filtered input settled
+  *          on, and the last edge back to the reported level is how long the
+  *          switch bounced, which sizes the following lockouts. An edge
+  *          within one lockout of the last one ending is bounce that
+  *          outlasted it: it is learned and locked out, not reported.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "button_capture.h"
+#include "button.h"
+#include "board_config.h"
+#include "clock.h"
+#include "stm32f4xx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CAPTURE_TICK_HZ     1000000U    /*!< 1 us counter */
+
+/* Private variables ---------------------------------------------------------*/
+static bool capture_pressed = false;    /*!< Level last reported */
+static uint32_t edge_us = 0;            /*!< Reported edge of the current lockout */
+static uint32_t lockout_end_us = 0;     /*!< End of the latest lockout */
+static uint32_t lockout_us = BUTTON_CAPTURE_LOCKOUT_MAX_US;
+static uint32_t bounce_env_us = 0;      /*!< Learned bounce envelope */
+static uint32_t last_bounce_us = 0;
+static uint32_t bounce_samples = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t capture_last_us(TIM_TypeDef *tim, bool pressed);
+static void capture_lockout(TIM_TypeDef *tim, uint32_t start_us);
+static void capture_listen(TIM_TypeDef *tim);
+#if BUTTON_CAPTURE_ADAPTIVE
+static void lockout_learn(uint32_t bounce_us);
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+void button_capture_init(void) {
+    BUTTON_CAPTURE_CLK_ENABLE();
+
+    /* PA0 to alternate function TIM5_CH1 */
+    GPIOA->MODER = (GPIOA->MODER & ~GPIO_MODER_MODER0) | GPIO_MODER_MODER0_1;
+    GPIOA->AFR[0] = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL0) |
+                    (BUTTON_CAPTURE_GPIO_AF << GPIO_AFRL_AFSEL0_Pos);
+
+    /* Free-running 32-bit us counter; tDTS = 4 tCK_INT stretches the filter */
+    BUTTON_CAPTURE_TIMER->CR1 = TIM_CR1_CKD_1;
+    BUTTON_CAPTURE_TIMER->PSC = (clock_get_apb1_timer_hz() / CAPTURE_TICK_HZ) - 1U;
+    BUTTON_CAPTURE_TIMER->ARR = 0xFFFFFFFFUL;
+
+    /* CC1: TI1 rising, CC2: TI1 falling, both filtered. CC3: output
+       compare (frozen), no pin */
+    BUTTON_CAPTURE_TIMER->CCMR1 = TIM_CCMR1_CC1S_0 |
+                                  (BUTTON_CAPTURE_FILTER << TIM_CCMR1_IC1F_Pos) |
+                                  TIM_CCMR1_CC2S_1 |
+                                  (BUTTON_CAPTURE_FILTER << TIM_CCMR1_IC2F_Pos);
+    BUTTON_CAPTURE_TIMER->CCMR2 = 0;
+    BUTTON_CAPTURE_TIMER->CCER = TIM_CCER_CC1E | TIM_CCER_CC2P | TIM_CCER_CC2E;
+
+    BUTTON_CAPTURE_TIMER->EGR = TIM_EGR_UG;     /* Load PSC */
+
+    /* Starting level only, before anything is captured */
+    capture_pressed = button_is_pressed_raw();
+    lockout_end_us = 0U - lockout_us;   /* No lockout to spill from yet */
+    capture_listen(BUTTON_CAPTURE_TIMER);
+
+    NVIC_SetPriority(BUTTON_CAPTURE_IRQN, BUTTON_CAPTURE_PRIORITY);
+    NVIC_EnableIRQ(BUTTON_CAPTURE_IRQN);
+
+    BUTTON_CAPTURE_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+uint32_t button_capture_now_us(void) {
+    return BUTTON_CAPTURE_TIMER->CNT;
+}
+
+void button_capture_get_debounce(button_debounce_t *info) {
+    info->window_us = lockout_us;
+    info->bounce_us = bounce_env_us;
+    info->last_bounce_us = last_bounce_us;
+    info->samples = bounce_samples;
+}
+
+void button_capture_handler(void) {
+    TIM_TypeDef *tim = BUTTON_CAPTURE_TIMER;
+    uint32_t sr = tim->SR;
+    uint32_t dier = tim->DIER;
+
+    if (sr & dier & (TIM_SR_CC1IF | TIM_SR_CC2IF)) {
+        /* Only the channel leaving the reported level listens: CC1 rises */
+        bool pressed = (dier & TIM_DIER_CC1IE) != 0;
+        uint32_t at_us = capture_last_us(tim, pressed);
+
+        if (at_us - lockout_end_us < lockout_us) {
+            /* Within a lockout of the last one ending: the bounce outlasted
+               it. Learn how far it spilled and lock out again from here;
+               the settle check at the end still reports a real change */
+#if BUTTON_CAPTURE_ADAPTIVE
+            lockout_learn(at_us - edge_us);
+#endif
+            capture_lockout(tim, at_us);
+            return;
+        }
+
+        capture_pressed = pressed;
+        edge_us = at_us;
+        button_edge(BUTTON_USER, capture_pressed, edge_us);
+
+        /* Ignore the bounce: no capture interrupts until the lockout ends */
+        capture_lockout(tim, edge_us);
+    }
+    else if ((sr & TIM_SR_CC3IF) && (dier & TIM_DIER_CC3IE)) {
+        /* Last edge each way since the reported one; older captures wrap
+           to beyond the time elapsed and do not count */
+        uint32_t forward = capture_last_us(tim, capture_pressed) - edge_us;
+        uint32_t back = capture_last_us(tim, !capture_pressed) - edge_us;
+        uint32_t elapsed = tim->CNT - edge_us;
+
+        if (back <= elapsed && back > forward) {
+            /* Settled on the other level: a press or release shorter than
+               the lockout. Report it when it was captured, locked out too */
+            capture_pressed = !capture_pressed;
+            edge_us += back;
+            button_edge(BUTTON_USER, capture_pressed, edge_us);
+            capture_lockout(tim, edge_us);
+            return;
+        }
+
+#if BUTTON_CAPTURE_ADAPTIVE
+        /* Settled where it was reported: it bounced until the last edge back */
+        lockout_learn(forward);
+#endif
+        capture_listen(tim);
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Get the last captured edge in one direction.
+  * @param  tim: Capture timer.
+  * @param  pressed: true for the press (rising) edge, false for release.
+  * @retval Capture time in us.
+  */
+static uint32_t capture_last_us(TIM_TypeDef *tim, bool pressed) {
+    return pressed ? tim->CCR1 : tim->CCR2;
+}
+
+/**
+  * @brief  Hold capture interrupts off for lockout_us.
+  * @param  tim: Capture timer.
+  * @param  start_us: Capture the lockout runs from.
+  * @retval None
+  */
+static void capture_lockout(TIM_TypeDef *tim, uint32_t start_us) {
+    lockout_end_us = start_us + lockout_us;
+    tim->CCR3 = lockout_end_us;
+    tim->SR = ~TIM_SR_CC3IF;
+    tim->DIER = TIM_DIER_CC3IE;
+
+    /* Reported late, the end may have passed already: end it now */
+    if (tim->CNT - start_us >= lockout_us) {
+        tim->EGR = TIM_EGR_CC3G;
+    }
+}
+
+/**
+  * @brief  Drop what was captured while locked out, listen for the next
+  *         change of level.
+  * @param  tim: Capture timer.
+  * @retval None
+  */
+static void capture_listen(TIM_TypeDef *tim) {
+    tim->SR = ~(TIM_SR_CC1IF | TIM_SR_CC1OF | TIM_SR_CC2IF | TIM_SR_CC2OF | TIM_SR_CC3IF);
+    tim->DIER = capture_pressed ? TIM_DIER_CC2IE : TIM_DIER_CC1IE;
+}
+
+#if BUTTON_CAPTURE_ADAPTIVE
+/**
+  * @brief  Fold one bounce measurement into the envelope, resize the lockout.
+  * @param  bounce_us: First to last edge of one settle, or to an edge that
+  *         spilled past the lockout.
+  * @retval None
+  */
+static void lockout_learn(uint32_t bounce_us) {
+    // Still bouncing near the end: the real bounce is longer than we saw.
+    // A spill past the end was seen, and counts as measured
+    if (bounce_us < lockout_us && bounce_us >= lockout_us - (lockout_us >> 2)) {
+        bounce_us = lockout_us;
+    }
+    last_bounce_us = bounce_us;
+    bounce_samples++;
+
+    // Worse is believed at once, better only slowly
+    if (bounce_us >= bounce_env_us) {
+        bounce_env_us = bounce_us;
+    } else {
+        bounce_env_us -= (bounce_env_us - bounce_us) >> BUTTON_CAPTURE_ADAPT_SHIFT;
+    }
+
+    uint32_t lockout = bounce_env_us * BUTTON_CAPTURE_ADAPT_MARGIN_PCT / 100U;
+    if (lockout < BUTTON_CAPTURE_LOCKOUT_MIN_US) lockout = BUTTON_CAPTURE_LOCKOUT_MIN_US;
+    if (lockout > BUTTON_CAPTURE_LOCKOUT_MAX_US) lockout = BUTTON_CAPTURE_LOCKOUT_MAX_US;
+    lockout_us = lockout;
+}
+#endif
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    button_oneshot.c
+  * @brief   EXTI + one-shot timer button backend implementation.
+  *
+  *          EXTI0 (any edge) -> masked by the dispatcher's top half
+  *          EXTI0 callback    -> note the time, start the timer
+  *          timer update      -> sample PA0, report a change with the noted
+  *                               time, clear and unmask EXTI0
+  *
+  *          The edge time is the first edge of the bounce, not the end of
+  *          the window, so gesture timing does not drift by the settle time.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "button_oneshot.h"
+#include "button.h"
+#include "board_config.h"
+#include "clock.h"
+#include "exti.h"
+#include "stm32f4xx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define ONESHOT_TICK_HZ     10000U      /*!< 100 us counter */
+#define ONESHOT_TICKS       (BUTTON_ONESHOT_SETTLE_MS * (ONESHOT_TICK_HZ / 1000U))
+
+#if ONESHOT_TICKS == 0 || ONESHOT_TICKS > 0x10000
+#error "BUTTON_ONESHOT_SETTLE_MS does not fit the 16-bit settle timer"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static bool oneshot_pressed = false;    /*!< Level last reported */
+static uint32_t edge_us = 0;            /*!< First edge of the current window */
+
+/* Private function prototypes -----------------------------------------------*/
+static void oneshot_start(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+void button_oneshot_init(void) {
+    BUTTON_ONESHOT_CLK_ENABLE();
+
+    /* One pulse; only counter overflow raises the update interrupt */
+    BUTTON_ONESHOT_TIMER->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+    BUTTON_ONESHOT_TIMER->PSC = (clock_get_apb1_timer_hz() / ONESHOT_TICK_HZ) - 1U;
+    BUTTON_ONESHOT_TIMER->ARR = ONESHOT_TICKS - 1U;
+    BUTTON_ONESHOT_TIMER->EGR = TIM_EGR_UG;     /* Load PSC */
+    BUTTON_ONESHOT_TIMER->SR = 0;
+    BUTTON_ONESHOT_TIMER->DIER = TIM_DIER_UIE;
+
+    oneshot_pressed = button_is_pressed_raw();
+
+    /* The first edge masks the line in the interrupt, before the bounce
+       can fire it again */
+    exti_set_oneshot(BUTTON_GPIO_PIN_NUM, true);
+
+    NVIC_SetPriority(BUTTON_ONESHOT_IRQN, BUTTON_ONESHOT_PRIORITY);
+    NVIC_EnableIRQ(BUTTON_ONESHOT_IRQN);
+}
+
+void button_oneshot_edge(void) {
+    oneshot_start();
+}
+
+void button_oneshot_handler(void) {
+    if (!(BUTTON_ONESHOT_TIMER->SR & TIM_SR_UIF)) return;
+    BUTTON_ONESHOT_TIMER->SR = ~TIM_SR_UIF;
+
+    bool pressed = button_is_pressed_raw();
+    if (pressed != oneshot_pressed) {
+        oneshot_pressed = pressed;
+        button_edge(BUTTON_USER, pressed, edge_us);
+    }
+
+    /* Forget the bounce, listen again */
+    exti_enable(BUTTON_GPIO_PIN_NUM, EXTI_PRIORITY);
+
+    /* An edge between the sample and the unmask would go unseen */
+    if (button_is_pressed_raw() != oneshot_pressed) {
+        exti_disable(BUTTON_GPIO_PIN_NUM);
+        oneshot_start();
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Run one settle window; EXTI0 is already masked.
+  * @retval None
+  */
+static void oneshot_start(void) {
+    edge_us = button_now_us();
+
+    BUTTON_ONESHOT_TIMER->CNT = 0;
+    BUTTON_ONESHOT_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+/******************************** END OF FILE *********************************/
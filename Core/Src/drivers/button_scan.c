@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    button_scan.c
+  * @brief   Vertical-counter debouncer implementation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "button_scan.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+void button_scan_reset(button_scan_t *scan, uint32_t state) {
+    scan->cnt0 = 0xFFFFFFFFUL;
+    scan->cnt1 = 0xFFFFFFFFUL;
+    scan->state = state;
+}
+
+uint32_t button_scan_step(button_scan_t *scan, uint32_t sample) {
+    uint32_t delta = scan->state ^ sample;
+
+    // Lanes that agree reload 3; the others count 3 -> 2 -> 1 -> 0 -> 3
+    scan->cnt0 = ~(scan->cnt0 & delta);
+    scan->cnt1 = scan->cnt0 ^ (scan->cnt1 & delta);
+
+    // Rolling over to 3 while still disagreeing means four samples in a row
+    uint32_t toggled = delta & scan->cnt0 & scan->cnt1;
+
+    scan->state ^= toggled;
+    return toggled;
+}
+
+/******************************** END OF FILE *********************************/
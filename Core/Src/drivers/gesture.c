@@ -0,0 +1,282 @@
+/**
+  ******************************************************************************
+  * @file    gesture.c
+  * @brief   Table-driven button gesture recognizer implementation.
+  *
+  *          Per button:
+  *
+  *            IDLE --press--> DOWN --release--> GAP --press--> DOWN ...
+  *                             |                 |
+  *                             |hold             |gap timeout
+  *                             v                 v
+  *                            HELD --repeat     IDLE
+  *
+  *          A release in DOWN counts a click (RELEASED, DOUBLE_CLICK, then
+  *          MULTI_CLICK); reaching max_clicks ends the run at once. A hold
+  *          reports LONG_PRESS, or CLICK_HOLD if clicks came before it.
+  *          Buttons held together as a BUTTON_CHORD_TABLE entry move to
+  *          CHORD and stay silent until released.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "gesture.h"
+#include "board_config.h"
+#include "systick.h"
+
+/* Private typedef -----------------------------------------------------------*/
+
+/**
+  * @brief  Recognizer states.
+  */
+typedef enum {
+    GESTURE_IGNORE = 0,     /*!< Table only: input has no effect here */
+    GESTURE_IDLE,           /*!< Released, no run in progress */
+    GESTURE_DOWN,           /*!< Pressed, hold timer running */
+    GESTURE_GAP,            /*!< Released inside a click run */
+    GESTURE_HELD,           /*!< Hold reported, repeating */
+    GESTURE_CHORD,          /*!< Part of a chord, waiting for release */
+    GESTURE_STATE_COUNT
+} gesture_state_t;
+
+/**
+  * @brief  Recognizer inputs.
+  */
+typedef enum {
+    GESTURE_IN_PRESS = 0,
+    GESTURE_IN_RELEASE,
+    GESTURE_IN_TIMEOUT,
+    GESTURE_IN_COUNT
+} gesture_input_t;
+
+/**
+  * @brief  One table cell: next state and what to do on the way.
+  */
+typedef struct {
+    uint8_t next;           /*!< gesture_state_t */
+    uint8_t actions;        /*!< ACT_* */
+} gesture_transition_t;
+
+/**
+  * @brief  Recognizer state of one button.
+  */
+typedef struct {
+    uint32_t deadline_us;   /*!< Pending timeout, valid if armed */
+    uint8_t state;          /*!< gesture_state_t */
+    uint8_t clicks;         /*!< Clicks in the current run */
+    uint8_t repeats;        /*!< Repeats of the current hold */
+} gesture_button_t;
+
+/* Private define ------------------------------------------------------------*/
+#define ACT_PRESSED         0x01U   /*!< Report PRESSED */
+#define ACT_CLICK           0x02U   /*!< Count a click and report it */
+#define ACT_HOLD            0x04U   /*!< Report LONG_PRESS / CLICK_HOLD */
+#define ACT_REPEAT          0x08U   /*!< Report REPEAT */
+#define ACT_RELEASED        0x10U   /*!< Report RELEASED */
+#define ACT_ARM_HOLD        0x20U   /*!< Timeout after hold_ms */
+#define ACT_ARM_GAP         0x40U   /*!< Timeout after click_gap_ms */
+#define ACT_ARM_REPEAT      0x80U   /*!< Timeout after repeat_ms */
+
+#define US_PER_MS           1000U
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Cells left out are GESTURE_IGNORE */
+static const gesture_transition_t transitions[GESTURE_STATE_COUNT][GESTURE_IN_COUNT] = {
+    [GESTURE_IDLE] = {
+        [GESTURE_IN_PRESS]   = { GESTURE_DOWN,  ACT_PRESSED | ACT_ARM_HOLD },
+    },
+    [GESTURE_DOWN] = {
+        [GESTURE_IN_RELEASE] = { GESTURE_GAP,   ACT_CLICK | ACT_ARM_GAP },
+        [GESTURE_IN_TIMEOUT] = { GESTURE_HELD,  ACT_HOLD | ACT_ARM_REPEAT },
+    },
+    [GESTURE_GAP] = {
+        [GESTURE_IN_PRESS]   = { GESTURE_DOWN,  ACT_PRESSED | ACT_ARM_HOLD },
+        [GESTURE_IN_TIMEOUT] = { GESTURE_IDLE,  0 },
+    },
+    [GESTURE_HELD] = {
+        [GESTURE_IN_RELEASE] = { GESTURE_IDLE,  ACT_RELEASED },
+        [GESTURE_IN_TIMEOUT] = { GESTURE_HELD,  ACT_REPEAT | ACT_ARM_REPEAT },
+    },
+    [GESTURE_CHORD] = {
+        [GESTURE_IN_RELEASE] = { GESTURE_IDLE,  0 },
+    },
+};
+
+static const button_profile_t profiles[BUTTON_COUNT] = BUTTON_PROFILE_TABLE;
+
+#if BUTTON_CHORD_COUNT > 0
+static const uint32_t chords[BUTTON_CHORD_COUNT] = BUTTON_CHORD_TABLE;
+#endif
+
+static gesture_button_t buttons[BUTTON_COUNT];
+static uint32_t held = 0;           /*!< Buttons down, bit per button_id_t */
+static uint32_t armed = 0;          /*!< Buttons with a pending timeout */
+static uint32_t next_due_us = 0;    /*!< Earliest pending timeout */
+static gesture_emit_t emit_cb = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void gesture_step(button_id_t button, gesture_input_t input, uint32_t now_us);
+static void gesture_arm(button_id_t button, uint32_t deadline_us);
+static void gesture_chord_check(uint32_t now_us);
+
+/* Exported functions --------------------------------------------------------*/
+
+void gesture_init(gesture_emit_t emit) {
+    emit_cb = emit;
+    held = 0;
+    armed = 0;
+
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        buttons[i].state = GESTURE_IDLE;
+        buttons[i].clicks = 0;
+        buttons[i].repeats = 0;
+    }
+}
+
+void gesture_edge(button_id_t button, bool pressed, uint32_t now_us) {
+    if (button >= BUTTON_COUNT) return;
+
+    if (pressed) {
+        held |= BUTTON_MASK(button);
+        gesture_step(button, GESTURE_IN_PRESS, now_us);
+        gesture_chord_check(now_us);
+    } else {
+        held &= ~BUTTON_MASK(button);
+        gesture_step(button, GESTURE_IN_RELEASE, now_us);
+    }
+}
+
+void gesture_tick(uint32_t now_us) {
+    if (armed == 0 || SYSTICK_BEFORE(now_us, next_due_us)) return;
+
+    // Something is due: fire it and find the next deadline
+    uint32_t pending = armed;
+    bool first = true;
+
+    while (pending) {
+        uint8_t button = BUTTON_LOWEST_BIT(pending);
+        gesture_button_t *g = &buttons[button];
+
+        pending &= pending - 1U;
+        if (!SYSTICK_BEFORE(now_us, g->deadline_us)) {
+            armed &= ~BUTTON_MASK(button);
+            // Chain from the deadline so auto-repeat keeps its period
+            gesture_step((button_id_t)button, GESTURE_IN_TIMEOUT, g->deadline_us);
+        }
+        if ((armed & BUTTON_MASK(button)) &&
+            (first || SYSTICK_BEFORE(g->deadline_us, next_due_us))) {
+            next_due_us = g->deadline_us;
+            first = false;
+        }
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Run one input through a button's transition table.
+  * @param  button: Button.
+  * @param  input: What happened.
+  * @param  now_us: When it happened.
+  * @retval None
+  */
+static void gesture_step(button_id_t button, gesture_input_t input, uint32_t now_us) {
+    gesture_button_t *g = &buttons[button];
+    const button_profile_t *profile = &profiles[button];
+    const gesture_transition_t *t = &transitions[g->state][input];
+    uint8_t actions = t->actions;
+    uint8_t next = t->next;
+
+    if (next == GESTURE_IGNORE) return;
+
+    if (actions & ACT_PRESSED) {
+        if (g->state == GESTURE_IDLE) g->clicks = 0;
+        emit_cb(button, BUTTON_EVENT_PRESSED, g->clicks, now_us);
+    }
+    if (actions & ACT_CLICK) {
+        if (g->clicks < UINT8_MAX) g->clicks++;
+
+        button_event_t event = (g->clicks == 1U) ? BUTTON_EVENT_RELEASED :
+                               (g->clicks == 2U) ? BUTTON_EVENT_DOUBLE_CLICK :
+                                                   BUTTON_EVENT_MULTI_CLICK;
+        emit_cb(button, event, g->clicks, now_us);
+
+        // Longest run reached: nothing to wait for
+        if (g->clicks >= profile->max_clicks) {
+            next = GESTURE_IDLE;
+            actions &= (uint8_t)~ACT_ARM_GAP;
+        }
+    }
+    if (actions & ACT_HOLD) {
+        g->repeats = 0;
+        emit_cb(button, (g->clicks == 0) ? BUTTON_EVENT_LONG_PRESS : BUTTON_EVENT_CLICK_HOLD,
+                g->clicks, now_us);
+    }
+    if (actions & ACT_REPEAT) {
+        if (g->repeats < UINT8_MAX) g->repeats++;
+        emit_cb(button, BUTTON_EVENT_REPEAT, g->repeats, now_us);
+    }
+    if (actions & ACT_RELEASED) {
+        emit_cb(button, BUTTON_EVENT_RELEASED, g->clicks, now_us);
+    }
+
+    // Every transition either arms its one timeout or drops it
+    armed &= ~BUTTON_MASK(button);
+    if (actions & ACT_ARM_HOLD) {
+        gesture_arm(button, now_us + profile->hold_ms * US_PER_MS);
+    } else if (actions & ACT_ARM_GAP) {
+        gesture_arm(button, now_us + profile->click_gap_ms * US_PER_MS);
+    } else if ((actions & ACT_ARM_REPEAT) && profile->repeat_ms != 0) {
+        gesture_arm(button, now_us + profile->repeat_ms * US_PER_MS);
+    }
+
+    g->state = next;
+}
+
+/**
+  * @brief  Start a button's timeout.
+  * @param  button: Button.
+  * @param  deadline_us: When it fires.
+  * @retval None
+  */
+static void gesture_arm(button_id_t button, uint32_t deadline_us) {
+    buttons[button].deadline_us = deadline_us;
+
+    if (armed == 0 || SYSTICK_BEFORE(deadline_us, next_due_us)) {
+        next_due_us = deadline_us;
+    }
+    armed |= BUTTON_MASK(button);
+}
+
+/**
+  * @brief  Report a chord once all of its buttons are down together.
+  * @note   Only buttons still in DOWN (no hold reported yet) take part.
+  * @param  now_us: Button clock.
+  * @retval None
+  */
+static void gesture_chord_check(uint32_t now_us) {
+#if BUTTON_CHORD_COUNT > 0
+    for (uint8_t c = 0; c < BUTTON_CHORD_COUNT; c++) {
+        uint32_t members = chords[c];
+
+        if (held != members) continue;
+
+        for (uint32_t bits = members; bits; bits &= bits - 1U) {
+            if (buttons[BUTTON_LOWEST_BIT(bits)].state != GESTURE_DOWN) return;
+        }
+        for (uint32_t bits = members; bits; bits &= bits - 1U) {
+            uint8_t button = BUTTON_LOWEST_BIT(bits);
+
+            buttons[button].state = GESTURE_CHORD;
+            armed &= ~BUTTON_MASK(button);
+        }
+        emit_cb((button_id_t)BUTTON_LOWEST_BIT(members), BUTTON_EVENT_CHORD, c, now_us);
+        return;
+    }
+#else
+    (void)now_us;
+#endif
+}
+
+/******************************** END OF FILE *********************************/
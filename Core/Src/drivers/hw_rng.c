@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    hw_rng.c
+  * @brief   STM32F4 hardware random number generator implementation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "hw_rng.h"
+#include "board_config.h"
+#include "stm32f4xx.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+void hw_rng_init(void) {
+    RCC->AHB2ENR |= RCC_AHB2ENR_RNGEN;
+    RNG->CR |= RNG_CR_RNGEN;
+}
+
+bool hw_rng_read(uint32_t *value) {
+    for (uint32_t polls = 0; polls < RNG_HW_TIMEOUT_POLLS; polls++) {
+        uint32_t status = RNG->SR;
+
+        if (status & (RNG_SR_SECS | RNG_SR_CECS)) {
+            // Seed or clock error: clear and restart the generator (RM0090 24.3.2)
+            RNG->SR = ~(RNG_SR_SEIS | RNG_SR_CEIS);
+            RNG->CR &= ~RNG_CR_RNGEN;
+            RNG->CR |= RNG_CR_RNGEN;
+            return false;
+        }
+
+        if (status & RNG_SR_DRDY) {
+            *value = RNG->DR;
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************** END OF FILE *********************************/
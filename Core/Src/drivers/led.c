@@ -1,82 +1,133 @@
 #include "led.h"
+#include "led_bcm.h"
 #include "board_config.h"
 #include "stm32f4xx.h"
 #include "systick.h"
+#include "clock.h"
 
-// Convert LED ID to GPIO pin
-static uint16_t led_id_to_pin(led_id_t led) {
-    switch (led) {
-        case LED_GREEN:  return LED_GREEN_PIN_MSK;
-        case LED_ORANGE: return LED_ORANGE_PIN_MSK;
-        case LED_RED:    return LED_RED_PIN_MSK;
-        case LED_BLUE:   return LED_BLUE_PIN_MSK;
-        default:         return 0;
-    }
-}
+#if LED_COUNT > 32
+#error "led_mask_t holds at most 32 LEDs"
+#endif
+
+// Board LED layout (see board_config.h), indexed directly by led_id_t
+static GPIO_TypeDef * const led_ports[LED_PORT_COUNT] = LED_PORT_TABLE;
+static const led_desc_t led_desc[LED_COUNT] = LED_DESCRIPTOR_TABLE;
 
+// Per-port pin masks derived from the table in led_init()
+static uint16_t port_pins[LED_PORT_COUNT];        // Every LED pin on the port
+static uint16_t port_active_low[LED_PORT_COUNT];  // LED pins that light when low
 
+// Peripheral bit-band alias of a single register bit (0x40000000-0x400FFFFF)
+#define LED_BITBAND(reg, bit) \
+    (*(volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)&(reg) - PERIPH_BASE) * 32U) + ((bit) * 4U)))
+
+#define LED_PIN_MODE_OUTPUT   1U
+#define LED_PIN_MODE_AF       2U
 
 // Static variables
 static led_blink_ctrl_t blink_ctrl[LED_COUNT] = {0};
+static uint8_t blink_heap[LED_COUNT];      // Blinking LEDs, min-heap on next_toggle_ms
+static uint8_t blink_heap_pos[LED_COUNT];  // Heap index of each blinking LED
+static uint8_t blink_heap_size = 0;
+static volatile led_mask_t led_state = 0;  // Logical ON state, the driver never reads ODR
+static volatile led_mask_t pwm_leds = 0;   // LEDs currently routed to the PWM timer
+
+static void led_pwm_init(void);
+static void led_pwm_release(led_mask_t leds);
+static void led_state_commit(led_mask_t leds, led_mask_t on, const uint32_t *bsrr);
+static void led_state_toggle(led_mask_t leds);
+static void blink_heap_push(led_id_t led);
+static void blink_heap_remove(led_id_t led);
+static void blink_heap_sift_down(uint8_t index);
+
+// BSRR word driving one LED to the requested state (polarity applied)
+static uint32_t led_bsrr(led_id_t led, bool state) {
+    const led_desc_t *desc = &led_desc[led];
+    uint32_t pin = 1U << desc->pin;
+
+    return (state != (desc->polarity == LED_ACTIVE_LOW)) ? pin : pin << 16;
+}
 
+// BSRR word driving every LED of a port to the same state
+static uint32_t port_bsrr_all(uint8_t port, bool state) {
+    uint32_t high_on = port_pins[port] & ~port_active_low[port];
+    uint32_t low_on = port_active_low[port];
+
+    return state ? (high_on | (low_on << 16)) : (low_on | (high_on << 16));
+}
+
+// Switch a pin between output and AF with two bit-band writes, so no MODER
+// read-modify-write can race another context touching the same port
+static void led_pin_mode(GPIO_TypeDef *port, uint32_t pin, uint32_t mode) {
+    LED_BITBAND(port->MODER, pin * 2 + 1) = (mode >> 1) & 1U;
+    LED_BITBAND(port->MODER, pin * 2) = mode & 1U;
+}
 
+// Atomically clear then set bits of a mask; returns the previous value
+static led_mask_t led_mask_exchange(volatile led_mask_t *mask, led_mask_t clear, led_mask_t set) {
+    led_mask_t old;
 
+    do {
+        old = __LDREXW(mask);
+    } while (__STREXW((old & ~clear) | set, mask) != 0);
 
+    return old;
+}
 
+// Convert LED ID to its PWM capture/compare register (NULL if none)
+static volatile uint32_t *led_id_to_ccr(led_id_t led) {
+    uint8_t channel = led_desc[led].pwm_channel;
 
+    // CCR1..CCR4 are consecutive registers
+    return (channel != 0) ? &LED_PWM_TIMER->CCR1 + (channel - 1U) : 0;
+}
 
 void led_init(void) {
-	// 1. Enable GPIO clock
+	// 1. Enable GPIO clock(s)
 	LED_GPIO_CLK_ENABLE();
 
-	// 2. Configure different LED pins
-	uint32_t pins[] = {LED_GREEN_PIN_NUM, LED_ORANGE_PIN_NUM, LED_RED_PIN_NUM, LED_BLUE_PIN_NUM};
-
-	for (int i = 0; i < 4; i++){
-		uint32_t pin = pins[i];
+	// 2. Configure every LED pin listed in the descriptor table
+	for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
+		const led_desc_t *desc = &led_desc[led];
+		GPIO_TypeDef *port = led_ports[desc->port];
+		uint32_t pin = desc->pin;
 
 		// MODER: Output mode
-		GPIOD -> MODER &= ~(3U << (pin * 2));
-		GPIOD -> MODER |= (1U << (pin *2));
+		port -> MODER &= ~(3U << (pin * 2));
+		port -> MODER |= (1U << (pin *2));
 
 		// OTYPE: Push-Pull
-		GPIOD -> OTYPER &= ~(pin);
+		port -> OTYPER &= ~(1U << pin);
 
 		// OSPEED: Medium speed
-		GPIOD -> OSPEEDR &= ~(3U << (pin * 2));
-		GPIOD -> OSPEEDR |= (2U << (pin * 2));
+		port -> OSPEEDR &= ~(3U << (pin * 2));
+		port -> OSPEEDR |= (2U << (pin * 2));
 
 		// PUPDR: No pull
-		GPIOD -> PUPDR &= ~(3U << (pin * 2));
+		port -> PUPDR &= ~(3U << (pin * 2));
+
+		port_pins[desc->port] |= (uint16_t)(1U << pin);
+		if (desc->polarity == LED_ACTIVE_LOW) {
+			port_active_low[desc->port] |= (uint16_t)(1U << pin);
+		}
 	}
 
+	// 3. PWM timer runs from the start; pins join it on led_set_brightness()
+	led_pwm_init();
+#if LED_BCM_ENABLED
+	led_bcm_init();
+#endif
 
-	// 3. Initial state: OFF
+	// 4. Initial state: OFF
 	led_all_off();
 }
 
 void led_on(led_id_t led) {
-    if (led == LED_ALL) {
-        led_all_on();
-        return;
-    }
-
-    if (led < LED_COUNT) {
-        uint16_t pin = led_id_to_pin(led);
-        LED_GPIO_PORT->BSRR = pin;  // Set pin (turn ON)
-    }
+    led_set(led, true);
 }
 
 void led_off(led_id_t led) {
-    if (led == LED_ALL) {
-        led_all_off();
-        return;
-    }
-
-    if (led < LED_COUNT) {
-        uint16_t pin = led_id_to_pin(led);
-        LED_GPIO_PORT->BSRR = (uint32_t)pin << 16;  // Reset pin (turn OFF)
-    }
+    led_set(led, false);
 }
 
 void led_toggle(led_id_t led) {
@@ -86,108 +137,259 @@ void led_toggle(led_id_t led) {
     }
 
     if (led < LED_COUNT) {
-        uint16_t pin = led_id_to_pin(led);
-        LED_GPIO_PORT->ODR ^= pin;  // Toggle using XOR
+        led_state_toggle(LED_MASK(led));
     }
 }
 
 bool led_is_on(led_id_t led) {
     if (led < LED_COUNT) {
-        uint16_t pin = led_id_to_pin(led);
-        return (LED_GPIO_PORT->ODR & pin) != 0;
+        if (pwm_leds & LED_MASK(led)) {
+            return *led_id_to_ccr(led) != 0;
+        }
+#if LED_BCM_ENABLED
+        if (led_bcm_active() & LED_MASK(led)) {
+            return led_bcm_get(led) != 0;
+        }
+#endif
+        return (led_state & LED_MASK(led)) != 0;
     }
     return false;
 }
 
 void led_set(led_id_t led, bool state) {
-    if (state) {
-        led_on(led);
-    } else {
-        led_off(led);
+    led_frame_t frame;
+
+    led_frame_begin(&frame);
+    led_frame_stage(&frame, led, state);
+    led_frame_commit(&frame);
+}
+
+void led_set_brightness(led_id_t led, uint16_t level) {
+    if (led == LED_ALL) {
+        for (led_id_t i = LED_GREEN; i < LED_COUNT; i++) {
+            led_set_brightness(i, level);
+        }
+        return;
+    }
+
+    if (led >= LED_COUNT) return;
+
+    if (level > LED_BRIGHTNESS_MAX) {
+        level = LED_BRIGHTNESS_MAX;
+    }
+
+    volatile uint32_t *ccr = led_id_to_ccr(led);
+    if (ccr == 0) {
+#if LED_BCM_ENABLED
+        // No timer channel on this pin: binary code modulation, 8-bit
+        led_bcm_set(led, (uint8_t)(level >> (LED_PWM_RESOLUTION_BITS - 8U)));
+#else
+        // No timer channel on this pin: best on/off approximation
+        led_set(led, level > LED_BRIGHTNESS_MAX / 2);
+#endif
+        return;
+    }
+
+    // CCRx is preloaded: the new duty starts on the next PWM period
+    *ccr = level;
+
+    if ((led_mask_exchange(&pwm_leds, 0, LED_MASK(led)) & LED_MASK(led)) == 0) {
+        // MODER: Alternate function (AFRx already selects the timer)
+        led_pin_mode(led_ports[led_desc[led].port], led_desc[led].pin, LED_PIN_MODE_AF);
+    }
+}
+
+uint16_t led_get_brightness(led_id_t led) {
+    if (led >= LED_COUNT) return 0;
+
+    if (pwm_leds & LED_MASK(led)) {
+        return (uint16_t)*led_id_to_ccr(led);
+    }
+#if LED_BCM_ENABLED
+    if (led_bcm_active() & LED_MASK(led)) {
+        return (uint16_t)(((uint32_t)led_bcm_get(led) * LED_BRIGHTNESS_MAX) / 255U);
     }
+#endif
+    return led_is_on(led) ? LED_BRIGHTNESS_MAX : 0;
 }
 
 void led_all_on(void) {
-    LED_GPIO_PORT->BSRR = LED_ALL_PINS;
+    led_set(LED_ALL, true);
 }
 
 void led_all_off(void) {
-    LED_GPIO_PORT->BSRR = (uint32_t)LED_ALL_PINS << 16;
+    led_set(LED_ALL, false);
 }
 
 void led_all_toggle(void) {
-    LED_GPIO_PORT->ODR ^= LED_ALL_PINS;
+    led_state_toggle(LED_MASK_ALL);
 }
 
-void led_set_pattern(uint8_t pattern) {
-    // Clear all LEDs first
-    led_all_off();
+void led_frame_begin(led_frame_t *frame) {
+    for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+        frame->bsrr[port] = 0;
+    }
+    frame->touched = 0;
+    frame->on = 0;
+}
+
+void led_frame_stage(led_frame_t *frame, led_id_t led, bool state) {
+    if (led == LED_ALL) {
+        for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+            frame->bsrr[port] = port_bsrr_all(port, state);
+        }
+        frame->touched = LED_MASK_ALL;
+        frame->on = state ? LED_MASK_ALL : 0;
+        return;
+    }
+
+    if (led >= LED_COUNT) return;
+
+    const led_desc_t *desc = &led_desc[led];
+    uint32_t pin = 1U << desc->pin;
 
-    // Set LEDs based on pattern bits
-    if (pattern & 0x01) led_on(LED_GREEN);   // Bit 0: Green
-    if (pattern & 0x02) led_on(LED_ORANGE);  // Bit 1: Orange
-    if (pattern & 0x04) led_on(LED_RED);     // Bit 2: Red
-    if (pattern & 0x08) led_on(LED_BLUE);    // Bit 3: Blue
+    // BSRR gives set priority over reset, so drop any earlier request
+    frame->bsrr[desc->port] = (frame->bsrr[desc->port] & ~(pin | (pin << 16))) | led_bsrr(led, state);
+    frame->touched |= LED_MASK(led);
+    frame->on = state ? (frame->on | LED_MASK(led)) : (frame->on & ~LED_MASK(led));
 }
 
-// Simple blocking delay (temporary - will be replaced by systick)
-static void delay_ms_blocking(uint32_t ms) {
-    for (uint32_t i = 0; i < ms * 1600; i++) {
-        __NOP();
+void led_frame_stage_mask(led_frame_t *frame, led_mask_t leds, led_mask_t on) {
+    leds &= LED_MASK_ALL;
+
+    // Visit only the LEDs named in the mask, highest ID first
+    while (leds) {
+        led_id_t led = (led_id_t)(31U - __CLZ(leds));
+        led_frame_stage(frame, led, (on & LED_MASK(led)) != 0);
+        leds &= ~LED_MASK(led);
     }
 }
 
-void led_chase(uint32_t delay_ms) {
-    static uint8_t chase_state = 0;
+void led_frame_stage_pattern(led_frame_t *frame, uint8_t pattern) {
+    led_frame_stage_mask(frame, LED_MASK_ALL, pattern);
+}
+
+void led_frame_commit(const led_frame_t *frame) {
+    if (frame->touched == 0) return;
 
-    led_all_off();
+    led_state_commit(frame->touched, frame->on, frame->bsrr);
+}
+
+void led_set_mask(led_mask_t on) {
+    led_frame_t frame;
+
+    led_frame_begin(&frame);
+    led_frame_stage_mask(&frame, LED_MASK_ALL, on);
+    led_frame_commit(&frame);
+}
+
+void led_set_pattern(uint8_t pattern) {
+    led_set_mask(pattern);
+}
+
+const led_desc_t *led_get_desc(led_id_t led) {
+    return (led < LED_COUNT) ? &led_desc[led] : 0;
+}
 
-    switch (chase_state) {
-        case 0: led_on(LED_GREEN); break;
-        case 1: led_on(LED_ORANGE); break;
-        case 2: led_on(LED_RED); break;
-        case 3: led_on(LED_BLUE); break;
+GPIO_TypeDef *led_get_port(uint8_t port) {
+    return (port < LED_PORT_COUNT) ? led_ports[port] : 0;
+}
+
+uint32_t led_port_word(uint8_t port, led_mask_t on) {
+    if (port >= LED_PORT_COUNT) return 0;
+
+    uint32_t word = port_bsrr_all(port, false);
+
+    for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
+        if (led_desc[led].port == port && (on & LED_MASK(led))) {
+            uint32_t pin = 1U << led_desc[led].pin;
+            word = (word & ~(pin | (pin << 16))) | led_bsrr(led, true);
+        }
+    }
+    return word;
+}
+
+// Effect state machines: each call runs at most one step and returns.
+// A step is due once its deadline passes; the next deadline advances from
+// the previous one so steps don't drift with superloop latency.
+typedef struct {
+    uint32_t next_step_ms;  // Absolute tick of the next step
+    uint8_t position;       // LED lit by the next step
+    int8_t direction;       // Knight rider sweep direction
+    bool running;           // false until the first step is drawn
+} led_effect_t;
+
+static led_effect_t chase_effect = { .direction = 1 };
+static led_effect_t knight_rider_effect = { .direction = 1 };
+
+// Check whether the effect is due and book its following step
+static bool led_effect_due(led_effect_t *effect, uint32_t period_ms) {
+    uint32_t now = systick_get_ticks();
+
+    if (effect->running && SYSTICK_BEFORE(now, effect->next_step_ms)) {
+        return false;
     }
 
-    chase_state = (chase_state + 1) % 4;
-    delay_ms_blocking(delay_ms);
+    // First step, or resumed after a stall: restart the cadence from now
+    if (!effect->running || SYSTICK_BEFORE(effect->next_step_ms + period_ms, now)) {
+        effect->next_step_ms = now;
+    }
+    effect->next_step_ms += period_ms;
+    effect->running = true;
+    return true;
+}
+
+void led_chase(uint32_t delay_ms) {
+    if (!led_effect_due(&chase_effect, delay_ms)) return;
+
+    // Exactly one LED lit, no dark gap between steps
+    led_set_mask(LED_MASK(chase_effect.position));
+
+    chase_effect.position = (uint8_t)((chase_effect.position + 1U) % LED_COUNT);
 }
 
 void led_knight_rider(void) {
-    static int8_t direction = 1;
-    static uint8_t position = 0;
+    led_effect_t *effect = &knight_rider_effect;
 
-    led_all_off();
+    if (!led_effect_due(effect, LED_KNIGHT_RIDER_STEP_MS)) return;
 
     // Light current position
-    led_set((led_id_t)position, true);
+    led_set_mask(LED_MASK(effect->position));
 
     // Update position
-    position += direction;
+    effect->position = (uint8_t)(effect->position + effect->direction);
 
     // Reverse direction at ends
-    if (position == 0 || position == LED_COUNT - 1) {
-        direction = -direction;
+    if (effect->position == 0 || effect->position == LED_COUNT - 1) {
+        effect->direction = (int8_t)-effect->direction;
     }
-
-    delay_ms_blocking(200);
 }
 
-// SIMPLE Blink - uses counter instead of time
+// Blink scheduler: blinking LEDs sit in a min-heap keyed on their next
+// toggle, so an update only looks at the heap root until something is due
 void led_blink(led_id_t led, uint32_t on_time_ms, uint32_t off_time_ms) {
 	if (led >= LED_COUNT || on_time_ms == 0 || off_time_ms == 0) return;
 
+    if (blink_ctrl[led].is_blinking) {
+        blink_heap_remove(led);
+    }
+
     blink_ctrl[led].on_time_ms = on_time_ms;
     blink_ctrl[led].off_time_ms = off_time_ms;
-    blink_ctrl[led].last_toggle_ms = systick_get_ticks();  // Use systick!
+    blink_ctrl[led].next_toggle_ms = systick_get_ticks() + on_time_ms;  // Use systick!
     blink_ctrl[led].is_on = true;
     blink_ctrl[led].is_blinking = true;
 
+    blink_heap_push(led);
     led_on(led);
 }
 
 void led_blink_stop(led_id_t led) {
     if (led >= LED_COUNT) return;
+
+    if (blink_ctrl[led].is_blinking) {
+        blink_heap_remove(led);
+    }
     blink_ctrl[led].is_blinking = false;
     led_off(led);
 }
@@ -196,50 +398,232 @@ void led_blink_stop(led_id_t led) {
 void led_update_all(void) {
     uint32_t current_time = systick_get_ticks();  // Get current time
 
-    for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
-        if (!blink_ctrl[led].is_blinking) continue;
+    // At most one toggle per blinking LED and pass: a toggled LED is always
+    // rescheduled after current_time, so it cannot come due again here
+    for (uint8_t pending = blink_heap_size; pending > 0; pending--) {
+        led_id_t led = (led_id_t)blink_heap[0];
+        led_blink_ctrl_t *ctrl = &blink_ctrl[led];
 
-        uint32_t elapsed = current_time - blink_ctrl[led].last_toggle_ms;
+        if (SYSTICK_BEFORE(current_time, ctrl->next_toggle_ms)) break;  // Nothing due
 
-        if (blink_ctrl[led].is_on) {
-            // Currently ON, check if time to turn OFF
-            if (elapsed >= blink_ctrl[led].on_time_ms) {
-                led_off(led);
-                blink_ctrl[led].is_on = false;
-                blink_ctrl[led].last_toggle_ms = current_time;
-            }
-        } else {
-            // Currently OFF, check if time to turn ON
-            if (elapsed >= blink_ctrl[led].off_time_ms) {
-                led_on(led);
-                blink_ctrl[led].is_on = true;
-                blink_ctrl[led].last_toggle_ms = current_time;
-            }
+        ctrl->is_on = !ctrl->is_on;
+        led_set(led, ctrl->is_on);
+
+        // Advance from the deadline, not from now, so late updates don't drift;
+        // after a long stall the phase just entered runs its full time from now
+        // instead of replaying every toggle
+        uint32_t phase_ms = ctrl->is_on ? ctrl->on_time_ms : ctrl->off_time_ms;
+
+        ctrl->next_toggle_ms += phase_ms;
+        if (!SYSTICK_BEFORE(current_time, ctrl->next_toggle_ms)) {
+            ctrl->next_toggle_ms = current_time + phase_ms;
         }
+
+        blink_heap_sift_down(0);
     }
 }
 
+bool led_next_deadline(uint32_t *deadline_ms) {
+    if (blink_heap_size == 0) return false;
 
+    *deadline_ms = blink_ctrl[blink_heap[0]].next_toggle_ms;
+    return true;
+}
 
+// Heap order: earlier deadline first
+static bool blink_heap_before(uint8_t a, uint8_t b) {
+    return SYSTICK_BEFORE(blink_ctrl[blink_heap[a]].next_toggle_ms,
+                          blink_ctrl[blink_heap[b]].next_toggle_ms);
+}
 
+static void blink_heap_swap(uint8_t a, uint8_t b) {
+    uint8_t led = blink_heap[a];
 
+    blink_heap[a] = blink_heap[b];
+    blink_heap[b] = led;
+    blink_heap_pos[blink_heap[a]] = a;
+    blink_heap_pos[blink_heap[b]] = b;
+}
 
+static void blink_heap_sift_up(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (uint8_t)((index - 1U) / 2U);
 
+        if (!blink_heap_before(index, parent)) break;
+        blink_heap_swap(index, parent);
+        index = parent;
+    }
+}
 
+static void blink_heap_sift_down(uint8_t index) {
+    for (;;) {
+        uint8_t left = (uint8_t)(2U * index + 1U);
+        uint8_t right = (uint8_t)(left + 1U);
+        uint8_t first = index;
 
+        if (left < blink_heap_size && blink_heap_before(left, first)) first = left;
+        if (right < blink_heap_size && blink_heap_before(right, first)) first = right;
+        if (first == index) break;
 
+        blink_heap_swap(index, first);
+        index = first;
+    }
+}
 
+static void blink_heap_push(led_id_t led) {
+    uint8_t index = blink_heap_size++;
 
+    blink_heap[index] = (uint8_t)led;
+    blink_heap_pos[led] = index;
+    blink_heap_sift_up(index);
+}
 
+static void blink_heap_remove(led_id_t led) {
+    uint8_t index = blink_heap_pos[led];
+    uint8_t last = --blink_heap_size;
 
+    if (index == last) return;
 
+    // Move the last entry into the hole and restore order either way
+    blink_heap_swap(index, last);
 
+    uint8_t moved = blink_heap[index];
+    blink_heap_sift_up(index);
+    blink_heap_sift_down(blink_heap_pos[moved]);
+}
 
+// Configure the PWM timer and every channel named in the descriptor table
+static void led_pwm_init(void) {
+    uint32_t steps = 1UL << LED_PWM_RESOLUTION_BITS;
+    uint32_t prescaler = clock_get_apb1_timer_hz() / (LED_PWM_FREQ_HZ * steps);
 
+    LED_PWM_TIMER_CLK_ENABLE();
 
+    LED_PWM_TIMER->CR1 = 0;
+    LED_PWM_TIMER->PSC = (prescaler > 0) ? prescaler - 1U : 0;
+    LED_PWM_TIMER->ARR = steps - 1U;
+    LED_PWM_TIMER->CCMR1 = 0;
+    LED_PWM_TIMER->CCMR2 = 0;
+    LED_PWM_TIMER->CCER = 0;
 
+    for (led_id_t led = LED_GREEN; led < LED_COUNT; led++) {
+        const led_desc_t *desc = &led_desc[led];
+        uint32_t channel = desc->pwm_channel;
 
+        if (channel == 0) continue;
 
+        *led_id_to_ccr(led) = 0;
 
+        // PWM mode 1 (110) with preload; odd channels at bit 0, even at bit 8
+        uint32_t ocm = (TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE) << (((channel - 1U) & 1U) * 8U);
+        if (channel <= 2) {
+            LED_PWM_TIMER->CCMR1 |= ocm;
+        } else {
+            LED_PWM_TIMER->CCMR2 |= ocm;
+        }
+
+        // Enable output; active-low LEDs get an inverted channel
+        uint32_t ccer = TIM_CCER_CC1E;
+        if (desc->polarity == LED_ACTIVE_LOW) {
+            ccer |= TIM_CCER_CC1P;
+        }
+        LED_PWM_TIMER->CCER |= ccer << ((channel - 1U) * 4U);
+
+        // AFR: select the timer; only used while MODER = AF
+        GPIO_TypeDef *port = led_ports[desc->port];
+        uint32_t shift = (desc->pin & 7U) * 4U;
+
+        port->AFR[desc->pin >> 3] &= ~(0xFU << shift);
+        port->AFR[desc->pin >> 3] |= (LED_PWM_GPIO_AF << shift);
+    }
+
+    LED_PWM_TIMER->CR1 = TIM_CR1_ARPE;
+    LED_PWM_TIMER->EGR = TIM_EGR_UG;       // Load PSC/ARR/CCRx shadows
+    LED_PWM_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+// Hand PWM-driven LEDs back to plain GPIO output (ODR drives them again)
+static void led_pwm_release(led_mask_t leds) {
+    if ((pwm_leds & leds) == 0) return;
+
+    // Only the context that actually clears the bit switches the pin
+    leds &= led_mask_exchange(&pwm_leds, leds, 0);
+
+    while (leds) {
+        led_id_t led = (led_id_t)(31U - __CLZ(leds));
+
+        led_pin_mode(led_ports[led_desc[led].port], led_desc[led].pin, LED_PIN_MODE_OUTPUT);
+        leds &= ~LED_MASK(led);
+    }
+}
+
+// Write one BSRR word per port, skipping ports with nothing to change
+static void led_bsrr_write(const uint32_t *bsrr) {
+    for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+        if (bsrr[port]) {
+            led_ports[port]->BSRR = bsrr[port];
+        }
+    }
+}
 
+// Drive the pins of `leds` to the committed shadow. A context that commits
+// after our STREX writes its own pins, possibly before ours land, so
+// re-drive from the shadow until it holds still for the pins we wrote.
+static void led_pins_settle(led_mask_t leds, led_mask_t state) {
+    uint32_t bsrr[LED_PORT_COUNT];
 
+    while ((led_state ^ state) & leds) {
+        state = led_state;
+
+        for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+            bsrr[port] = 0;
+        }
+        led_mask_t pending = leds;
+        while (pending) {
+            led_id_t led = (led_id_t)(31U - __CLZ(pending));
+            bsrr[led_desc[led].port] |= led_bsrr(led, (state & LED_MASK(led)) != 0);
+            pending &= ~LED_MASK(led);
+        }
+        led_bsrr_write(bsrr);
+    }
+}
+
+// Update the shadow of `leds` with LDREX/STREX, then drive the pins. The
+// exclusive section holds no other store: whether a store clears the
+// monitor is implementation defined in ARMv7-M, so the BSRR writes follow
+// the commit instead of sitting inside it.
+static void led_state_commit(led_mask_t leds, led_mask_t on, const uint32_t *bsrr) {
+    led_mask_t state;
+
+#if LED_BCM_ENABLED
+    // Take the pins off the BCM interrupt first, or its next plane undoes us
+    led_bcm_release(leds);
+#endif
+
+    do {
+        state = (__LDREXW(&led_state) & ~leds) | (on & leds);
+    } while (__STREXW(state, &led_state) != 0);
+
+    led_bsrr_write(bsrr);
+    led_pins_settle(leds, state);
+
+    led_pwm_release(leds);
+}
+
+// Toggle `leds` from the shadow state with BSRR writes only (no ODR ^=)
+static void led_state_toggle(led_mask_t leds) {
+    led_mask_t state;
+
+#if LED_BCM_ENABLED
+    led_bcm_release(leds);
+#endif
+
+    do {
+        state = __LDREXW(&led_state) ^ leds;
+    } while (__STREXW(state, &led_state) != 0);
+
+    // Nothing written yet: settle from a state that differs on every pin
+    led_pins_settle(leds, ~state);
+
+    led_pwm_release(leds);
+}
@@ -0,0 +1,191 @@
+/**
+  ******************************************************************************
+  * @file    led_bcm.c
+  * @brief   Binary code modulation brightness backend implementation.
+  *
+  *          Each frame is split into 8 slots whose lengths are 1, 2, 4 .. 128
+  *          times LED_BCM_LSB_TICKS. At the start of slot b every BCM-driven
+  *          LED is switched to bit b of its level, so the LED is on for
+  *          exactly `level` LSB slots per frame. That costs 8 interrupts per
+  *          frame for any number of LEDs, where soft-PWM needs 255.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_bcm.h"
+#include "board_config.h"
+#include "clock.h"
+#include "stm32f4xx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BCM_BITS            8U
+
+/* Private variables ---------------------------------------------------------*/
+
+/**
+  * @brief  BSRR word per plane set, bit plane and LED port.
+  * @note   The ISR plays bcm_planes[bcm_front]; the main context patches the
+  *         other set and flags it pending, and the ISR swaps at frame start.
+  */
+static uint32_t bcm_planes[2][BCM_BITS][LED_PORT_COUNT];
+static volatile uint32_t bcm_front = 0;
+static volatile uint32_t bcm_pending = 0;
+
+static volatile uint32_t bcm_port_mask[LED_PORT_COUNT];  /*!< Pins (both BSRR halves) the ISR drives */
+static volatile led_mask_t bcm_leds = 0;                 /*!< LEDs owned by BCM */
+static uint8_t bcm_level[LED_COUNT];
+static GPIO_TypeDef *bcm_ports[LED_PORT_COUNT];
+static uint8_t bcm_bit = 0;
+static volatile bool bcm_running = false;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t bcm_exchange(volatile uint32_t *word, uint32_t clear, uint32_t set);
+static void bcm_start(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+void led_bcm_init(void) {
+    for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+        bcm_ports[port] = led_get_port(port);
+    }
+
+    LED_BCM_TIMER_CLK_ENABLE();
+
+    /* No ARR preload: the ISR sets the length of the slot that just began */
+    LED_BCM_TIMER->CR1 = 0;
+    LED_BCM_TIMER->PSC = (clock_get_apb1_timer_hz() / LED_BCM_TICK_HZ) - 1U;
+    LED_BCM_TIMER->ARR = LED_BCM_LSB_TICKS - 1U;
+    LED_BCM_TIMER->EGR = TIM_EGR_UG;    /* Load PSC */
+    LED_BCM_TIMER->SR = 0;
+    LED_BCM_TIMER->DIER = TIM_DIER_UIE;
+
+    NVIC_SetPriority(LED_BCM_IRQN, LED_BCM_PRIORITY);
+    NVIC_EnableIRQ(LED_BCM_IRQN);
+}
+
+void led_bcm_set(led_id_t led, uint8_t level) {
+    if (led >= LED_COUNT) return;
+
+    const led_desc_t *desc = led_get_desc(led);
+    uint32_t pins = (1U << desc->pin) | (1U << (desc->pin + 16U));
+    uint32_t on_word = (desc->polarity == LED_ACTIVE_LOW) ? (1U << (desc->pin + 16U)) : (1U << desc->pin);
+    uint32_t off_word = pins & ~on_word;
+
+    /* Withdraw the back set from the ISR before touching it */
+    bool was_pending = bcm_exchange(&bcm_pending, 1U, 0) != 0;
+    uint32_t back = bcm_front ^ 1U;
+
+    if (!was_pending) {
+        /* Back set is stale - start from what is playing now */
+        for (uint32_t bit = 0; bit < BCM_BITS; bit++) {
+            for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+                bcm_planes[back][bit][port] = bcm_planes[back ^ 1U][bit][port];
+            }
+        }
+    }
+
+    for (uint32_t bit = 0; bit < BCM_BITS; bit++) {
+        uint32_t *word = &bcm_planes[back][bit][desc->port];
+        *word = (*word & ~pins) | ((level & (1U << bit)) ? on_word : off_word);
+    }
+
+    __DMB();
+    bcm_pending = 1U;
+
+    bcm_level[led] = level;
+    bcm_exchange(&bcm_port_mask[desc->port], 0, pins);
+    bcm_exchange(&bcm_leds, 0, LED_MASK(led));
+
+    if (!bcm_running) {
+        bcm_start();
+    }
+}
+
+uint8_t led_bcm_get(led_id_t led) {
+    if (led >= LED_COUNT || (bcm_leds & LED_MASK(led)) == 0) return 0;
+    return bcm_level[led];
+}
+
+led_mask_t led_bcm_active(void) {
+    return bcm_leds;
+}
+
+void led_bcm_release(led_mask_t leds) {
+    if ((bcm_leds & leds) == 0) return;
+
+    /* Only the context that actually clears an LED unmasks its pins */
+    leds &= bcm_exchange(&bcm_leds, leds, 0);
+
+    while (leds) {
+        led_id_t led = (led_id_t)(31U - __CLZ(leds));
+        const led_desc_t *desc = led_get_desc(led);
+
+        bcm_exchange(&bcm_port_mask[desc->port], (1U << desc->pin) | (1U << (desc->pin + 16U)), 0);
+        leds &= ~LED_MASK(led);
+    }
+}
+
+void led_bcm_timer_handler(void) {
+    if ((LED_BCM_TIMER->SR & TIM_SR_UIF) == 0) return;
+    LED_BCM_TIMER->SR = ~TIM_SR_UIF;
+
+    if (bcm_bit == 0) {
+        /* Frame boundary: idle out, or swap in the patched plane set */
+        if (bcm_leds == 0) {
+            LED_BCM_TIMER->CR1 &= ~TIM_CR1_CEN;
+            bcm_running = false;
+            return;
+        }
+        if (bcm_pending) {
+            bcm_front ^= 1U;
+            bcm_pending = 0;
+        }
+    }
+
+    const uint32_t *plane = bcm_planes[bcm_front][bcm_bit];
+
+    for (uint8_t port = 0; port < LED_PORT_COUNT; port++) {
+        uint32_t mask = bcm_port_mask[port];
+        if (mask) {
+            bcm_ports[port]->BSRR = plane[port] & mask;
+        }
+    }
+
+    /* Counter restarted at this update: set the length of slot bcm_bit */
+    LED_BCM_TIMER->ARR = (LED_BCM_LSB_TICKS << bcm_bit) - 1U;
+    bcm_bit = (uint8_t)((bcm_bit + 1U) & (BCM_BITS - 1U));
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Atomically clear then set bits of a word shared with the ISR.
+  * @param  word: Word to update.
+  * @param  clear: Bits to clear.
+  * @param  set: Bits to set.
+  * @retval Previous value.
+  */
+static uint32_t bcm_exchange(volatile uint32_t *word, uint32_t clear, uint32_t set) {
+    uint32_t old;
+
+    do {
+        old = __LDREXW(word);
+    } while (__STREXW((old & ~clear) | set, word) != 0);
+
+    return old;
+}
+
+/**
+  * @brief  Start the frame timer at bit plane 0.
+  * @retval None
+  */
+static void bcm_start(void) {
+    bcm_bit = 0;
+    bcm_running = true;
+
+    LED_BCM_TIMER->CNT = 0;
+    LED_BCM_TIMER->ARR = LED_BCM_LSB_TICKS - 1U;
+    LED_BCM_TIMER->CR1 = TIM_CR1_CEN;
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    led_stream.c
+  * @brief   DMA-streamed BSRR waveform playback implementation.
+  *
+  *          LED_STREAM_TIMER raises an update DMA request once per frame and
+  *          the DMA stream copies the next 32-bit word into the LED port BSRR.
+  *          Frame timing is therefore set by the timer alone and does not
+  *          depend on how busy the superloop is.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_stream.h"
+#include "led.h"
+#include "board_config.h"
+#include "clock.h"
+#include "stm32f4xx.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (LED_STREAM_BUFFER_WORDS < 2U) || ((LED_STREAM_BUFFER_WORDS % 2U) != 0U)
+#error "LED_STREAM_BUFFER_WORDS must be an even number of words"
+#endif
+
+#define STREAM_HALF_WORDS    (LED_STREAM_BUFFER_WORDS / 2U)
+
+/* Status/clear bits of DMA2 Stream1 in LISR/LIFCR */
+#define STREAM_FLAG_HT       DMA_LISR_HTIF1
+#define STREAM_FLAG_TC       DMA_LISR_TCIF1
+#define STREAM_FLAG_TE       DMA_LISR_TEIF1
+#define STREAM_CLEAR_ALL     (DMA_LIFCR_CTCIF1 | DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTEIF1 | \
+                              DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CFEIF1)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t stream_buffer[LED_STREAM_BUFFER_WORDS];
+static led_stream_refill_t stream_refill = 0;
+static void *stream_context = 0;
+static uint16_t stream_length = 0;
+static volatile bool stream_active = false;
+
+/* Private function prototypes -----------------------------------------------*/
+static void stream_timer_config(uint32_t frame_period_us);
+static void stream_dma_start(const uint32_t *words, uint16_t count, uint32_t irq_enable,
+                             uint32_t first_elapsed_us);
+
+/* Exported functions --------------------------------------------------------*/
+
+void led_stream_init(void) {
+    LED_STREAM_CLK_ENABLE();
+
+    /* Timer stopped, no DMA request yet */
+    LED_STREAM_TIMER->CR1 = 0;
+    LED_STREAM_TIMER->DIER = 0;
+    LED_STREAM_TIMER->RCR = 0;
+
+    /* DMA stream disabled and idle */
+    LED_STREAM_DMA_STREAM->CR = 0;
+    while (LED_STREAM_DMA_STREAM->CR & DMA_SxCR_EN);
+    LED_STREAM_DMA->LIFCR = STREAM_CLEAR_ALL;
+
+    NVIC_SetPriority(LED_STREAM_DMA_IRQN, LED_STREAM_PRIORITY);
+    NVIC_EnableIRQ(LED_STREAM_DMA_IRQN);
+}
+
+void led_stream_play(const uint32_t *words, uint16_t count, uint32_t frame_period_us,
+                     uint32_t first_elapsed_us) {
+    if (words == 0 || count == 0) return;
+
+    led_stream_stop();
+
+    stream_refill = 0;
+    stream_context = 0;
+
+    stream_timer_config(frame_period_us);
+    stream_dma_start(words, count, 0, first_elapsed_us);
+}
+
+void led_stream_start(uint32_t frame_period_us, led_stream_refill_t refill, void *context) {
+    if (refill == 0) return;
+
+    led_stream_stop();
+
+    stream_refill = refill;
+    stream_context = context;
+
+    /* Both halves must be valid before the first frame goes out */
+    refill(stream_buffer, LED_STREAM_BUFFER_WORDS, context);
+
+    stream_timer_config(frame_period_us);
+    stream_dma_start(stream_buffer, LED_STREAM_BUFFER_WORDS, DMA_SxCR_HTIE | DMA_SxCR_TCIE, 0);
+}
+
+uint16_t led_stream_stop(void) {
+    if (!stream_active) return 0;
+
+    /* Stop requests first so no transfer is in flight when EN drops */
+    LED_STREAM_TIMER->CR1 &= ~TIM_CR1_CEN;
+    LED_STREAM_TIMER->DIER &= ~TIM_DIER_UDE;
+
+    LED_STREAM_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    while (LED_STREAM_DMA_STREAM->CR & DMA_SxCR_EN);
+
+    uint16_t remaining = (uint16_t)LED_STREAM_DMA_STREAM->NDTR;
+    LED_STREAM_DMA->LIFCR = STREAM_CLEAR_ALL;
+    stream_active = false;
+
+    return (uint16_t)((stream_length - remaining) % stream_length);
+}
+
+bool led_stream_is_active(void) {
+    return stream_active;
+}
+
+uint32_t led_stream_word(uint8_t pattern) {
+    return led_port_word(LED_STREAM_PORT, pattern);
+}
+
+void led_stream_dma_handler(void) {
+    uint32_t flags = LED_STREAM_DMA->LISR;
+
+    if (flags & STREAM_FLAG_HT) {
+        /* First half played out - refill it while the second half runs */
+        LED_STREAM_DMA->LIFCR = DMA_LIFCR_CHTIF1;
+        if (stream_refill) {
+            stream_refill(&stream_buffer[0], STREAM_HALF_WORDS, stream_context);
+        }
+    }
+
+    if (flags & STREAM_FLAG_TC) {
+        /* Second half played out - DMA has wrapped to the first half */
+        LED_STREAM_DMA->LIFCR = DMA_LIFCR_CTCIF1;
+        if (stream_refill) {
+            stream_refill(&stream_buffer[STREAM_HALF_WORDS], STREAM_HALF_WORDS, stream_context);
+        }
+    }
+
+    if (flags & STREAM_FLAG_TE) {
+        /* Hardware has already disabled the stream */
+        LED_STREAM_DMA->LIFCR = DMA_LIFCR_CTEIF1;
+        LED_STREAM_TIMER->CR1 &= ~TIM_CR1_CEN;
+        LED_STREAM_TIMER->DIER &= ~TIM_DIER_UDE;
+        stream_active = false;
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Program the timer update rate to one event per frame.
+  * @param  frame_period_us: Frame period in microseconds.
+  * @retval None
+  */
+static void stream_timer_config(uint32_t frame_period_us) {
+    uint32_t ticks_per_us = clock_get_apb2_timer_hz() / 1000000U;
+    uint32_t max_period_us = 0xFFFFFFFFU / ticks_per_us;
+
+    if (frame_period_us > max_period_us) frame_period_us = max_period_us;
+    if (frame_period_us == 0) frame_period_us = 1;
+
+    /* Split the frame into PSC x ARR so that ARR fits in 16 bits */
+    uint32_t ticks = ticks_per_us * frame_period_us;
+    uint32_t prescaler = (ticks - 1U) / 65536U;
+    if (prescaler > 0xFFFFU) prescaler = 0xFFFFU;
+
+    uint32_t reload = ticks / (prescaler + 1U);
+
+    LED_STREAM_TIMER->PSC = prescaler;
+    LED_STREAM_TIMER->ARR = (reload > 0) ? reload - 1U : 0;
+    LED_STREAM_TIMER->CNT = 0;
+}
+
+/**
+  * @brief  Start the circular memory-to-BSRR transfer and the frame timer.
+  * @param  words: Source words.
+  * @param  count: Number of words in the circular buffer.
+  * @param  irq_enable: Extra DMA_SxCR interrupt enables (HTIE/TCIE).
+  * @param  first_elapsed_us: Part of the first frame already elapsed.
+  * @retval None
+  */
+static void stream_dma_start(const uint32_t *words, uint16_t count, uint32_t irq_enable,
+                             uint32_t first_elapsed_us) {
+    /* BSRR writes from DMA are invisible on pins still routed to TIM4 */
+    led_all_off();
+
+    stream_length = count;
+    LED_STREAM_DMA->LIFCR = STREAM_CLEAR_ALL;
+
+    LED_STREAM_DMA_STREAM->PAR  = (uint32_t)&led_get_port(LED_STREAM_PORT)->BSRR;
+    LED_STREAM_DMA_STREAM->M0AR = (uint32_t)words;
+    LED_STREAM_DMA_STREAM->NDTR = count;
+    LED_STREAM_DMA_STREAM->FCR  = 0;  /* Direct mode */
+
+    LED_STREAM_DMA_STREAM->CR = (LED_STREAM_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) |
+                                DMA_SxCR_PL_1   |  /* High priority */
+                                DMA_SxCR_MSIZE_1 |  /* 32-bit memory */
+                                DMA_SxCR_PSIZE_1 |  /* 32-bit peripheral */
+                                DMA_SxCR_MINC   |
+                                DMA_SxCR_CIRC   |
+                                DMA_SxCR_DIR_0  |  /* Memory to peripheral */
+                                DMA_SxCR_TEIE   |
+                                irq_enable;
+    LED_STREAM_DMA_STREAM->CR |= DMA_SxCR_EN;
+    stream_active = true;
+
+    /* UG issues the first request now, so frame 0 is not one period late */
+    LED_STREAM_TIMER->DIER = TIM_DIER_UDE;
+    LED_STREAM_TIMER->EGR = TIM_EGR_UG;
+
+    /* UG cleared CNT: start it partway so frame 0 only shows what is left */
+    if (first_elapsed_us) {
+        uint32_t ticks_per_us = clock_get_apb2_timer_hz() / 1000000U;
+        uint32_t elapsed = (uint32_t)(((uint64_t)first_elapsed_us * ticks_per_us) /
+                                      (LED_STREAM_TIMER->PSC + 1U));
+        LED_STREAM_TIMER->CNT = (elapsed < LED_STREAM_TIMER->ARR) ? elapsed : LED_STREAM_TIMER->ARR;
+    }
+    LED_STREAM_TIMER->CR1 = TIM_CR1_CEN;
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file    clock.c
+  * @brief   Bus and timer clock queries.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clock.h"
+#include "stm32f4xx.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t timer_clock_from_prescaler(uint32_t ppre);
+
+/* Exported functions --------------------------------------------------------*/
+
+uint32_t clock_get_apb1_timer_hz(void) {
+    return timer_clock_from_prescaler((RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos);
+}
+
+uint32_t clock_get_apb2_timer_hz(void) {
+    return timer_clock_from_prescaler((RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Convert a PPREx field into the clock seen by timers on that bus.
+  * @note   0xx = HCLK not divided. 1xx = HCLK / 2^(xx+1), and timers then
+  *         run at twice the bus clock (RM0090, clock tree).
+  * @param  ppre: 3-bit PPRE1/PPRE2 field value.
+  * @retval Timer clock in Hz.
+  */
+static uint32_t timer_clock_from_prescaler(uint32_t ppre) {
+    if ((ppre & 0x4U) == 0U) {
+        return SystemCoreClock;
+    }
+
+    uint32_t pclk = SystemCoreClock >> ((ppre & 0x3U) + 1U);
+    return pclk * 2U;
+}
+
+/******************************** END OF FILE *********************************/
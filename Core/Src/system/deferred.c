@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    deferred.c
+  * @brief   Deferred work queue implementation.
+  *
+  *          A ring of DEFERRED_QUEUE_SIZE slots. Producers claim a slot by
+  *          moving the head with LDREX/STREX, fill it, then mark it ready;
+  *          a producer preempted between claim and ready only delays the
+  *          items behind it, because it pends PendSV again once it is done.
+  *          PendSV is the only consumer and owns the tail.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "deferred.h"
+#include "board_config.h"
+#include "stm32f4xx.h"
+
+/* Private typedef -----------------------------------------------------------*/
+
+/**
+  * @brief  One queued work item.
+  */
+typedef struct {
+    deferred_fn_t fn;
+    uint32_t arg;
+    volatile uint32_t ready;    /*!< Set by the producer once fn/arg are in */
+} deferred_item_t;
+
+/* Private define ------------------------------------------------------------*/
+#define DEFERRED_QUEUE_MASK (DEFERRED_QUEUE_SIZE - 1U)
+
+#if (DEFERRED_QUEUE_SIZE & DEFERRED_QUEUE_MASK) != 0
+#error "DEFERRED_QUEUE_SIZE must be a power of two"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static deferred_item_t queue[DEFERRED_QUEUE_SIZE];
+static volatile uint32_t queue_head = 0;    /*!< Next slot to claim */
+static volatile uint32_t queue_tail = 0;    /*!< Next slot to run */
+static volatile uint32_t queue_dropped = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void deferred_count_drop(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+void deferred_init(void) {
+    for (uint32_t i = 0; i < DEFERRED_QUEUE_SIZE; i++) {
+        queue[i].ready = 0;
+    }
+    queue_tail = queue_head;
+    queue_dropped = 0;
+
+    NVIC_SetPriority(PendSV_IRQn, DEFERRED_PRIORITY);
+}
+
+bool deferred_post(deferred_fn_t fn, uint32_t arg) {
+    uint32_t head;
+
+    // Claim a slot: retry if anything touched the head in between
+    do {
+        head = __LDREXW(&queue_head);
+        if (head - queue_tail >= DEFERRED_QUEUE_SIZE) {
+            __CLREX();
+            deferred_count_drop();
+            return false;
+        }
+    } while (__STREXW(head + 1U, &queue_head) != 0);
+
+    deferred_item_t *item = &queue[head & DEFERRED_QUEUE_MASK];
+    item->fn = fn;
+    item->arg = arg;
+
+    // Publish only once the item is written
+    __DMB();
+    item->ready = 1U;
+
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    return true;
+}
+
+uint32_t deferred_get_dropped(void) {
+    return queue_dropped;
+}
+
+void deferred_run(void) {
+    uint32_t tail = queue_tail;
+
+    while (tail != queue_head) {
+        deferred_item_t *item = &queue[tail & DEFERRED_QUEUE_MASK];
+
+        // Claimed but not filled yet: its producer pends PendSV again
+        if (!item->ready) break;
+
+        // Read the item only after seeing it ready
+        __DMB();
+        deferred_fn_t fn = item->fn;
+        uint32_t arg = item->arg;
+
+        // Hand the slot back before running, so fn may post again
+        item->ready = 0;
+        __DMB();
+        queue_tail = ++tail;
+
+        fn(arg);
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Count a dropped item; producers may race, so no lost update.
+  * @retval None
+  */
+static void deferred_count_drop(void) {
+    uint32_t dropped;
+
+    do {
+        dropped = __LDREXW(&queue_dropped);
+    } while (__STREXW(dropped + 1U, &queue_dropped) != 0);
+}
+
+/******************************** END OF FILE *********************************/
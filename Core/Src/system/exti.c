@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    exti.c
+  * @brief   EXTI line dispatcher implementation.
+  *
+  *          Top half (EXTI vector): decode, clear, mask one-shot lines,
+  *          add the lines to a pending mask, post one work item unless
+  *          one is queued. A full queue leaves the lines pending for the
+  *          next dispatch or exti_retry() after the queue drains.
+  *          Bottom half (PendSV): take the whole mask, run the callbacks.
+  *          A bounce storm on a line therefore costs one short interrupt per
+  *          edge and one callback per PendSV pass.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "exti.h"
+#include "board_config.h"
+#include "deferred.h"
+
+/* Private define ------------------------------------------------------------*/
+#define GPIO_PORT_STRIDE_LOG2   10U     /*!< GPIOA, GPIOB, ... are 0x400 apart */
+
+/* Bit-band alias of one IMR bit: masking a line is a single store, so the
+   top half can mask lines without racing a read-modify-write below it */
+#define EXTI_IMR_BIT(line) \
+    (*(volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)&EXTI->IMR - PERIPH_BASE) * 32U) + ((line) * 4U)))
+
+/* Private variables ---------------------------------------------------------*/
+static exti_callback_t callbacks[EXTI_LINE_COUNT][EXTI_CALLBACKS_PER_LINE];
+static uint8_t callback_count[EXTI_LINE_COUNT];
+static volatile uint32_t deferred_lines = 0;    /*!< Fired, callbacks not run yet */
+static volatile uint32_t bottom_half_queued = 0; /*!< exti_bottom_half() is in the queue */
+static uint32_t oneshot_lines = 0;              /*!< Masked by the top half when they fire */
+
+/* Private function prototypes -----------------------------------------------*/
+static IRQn_Type exti_irqn(uint8_t line);
+static void exti_post(void);
+static void exti_bottom_half(uint32_t arg);
+static void lines_add(uint32_t lines);
+static uint32_t lines_take(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+void exti_configure(GPIO_TypeDef *port, uint8_t line, exti_trigger_t trigger) {
+    if (line >= EXTI_LINE_COUNT) return;
+
+    uint32_t bit = 1UL << line;
+    uint32_t shift = (line & 3U) * 4U;
+    uint32_t port_index = ((uint32_t)port - GPIOA_BASE) >> GPIO_PORT_STRIDE_LOG2;
+
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    SYSCFG->EXTICR[line >> 2] = (SYSCFG->EXTICR[line >> 2] & ~(0xFUL << shift)) |
+                                (port_index << shift);
+
+    if (trigger & EXTI_TRIGGER_RISING) EXTI->RTSR |= bit; else EXTI->RTSR &= ~bit;
+    if (trigger & EXTI_TRIGGER_FALLING) EXTI->FTSR |= bit; else EXTI->FTSR &= ~bit;
+}
+
+bool exti_register(uint8_t line, exti_callback_t callback) {
+    if (line >= EXTI_LINE_COUNT || callback == 0) return false;
+    if (callback_count[line] >= EXTI_CALLBACKS_PER_LINE) return false;
+
+    // Publish the slot before the count that makes it visible to the handler
+    callbacks[line][callback_count[line]] = callback;
+    __DMB();
+    callback_count[line]++;
+    return true;
+}
+
+void exti_enable(uint8_t line, uint32_t priority) {
+    if (line >= EXTI_LINE_COUNT) return;
+
+    IRQn_Type irqn = exti_irqn(line);
+
+    EXTI->PR = 1UL << line;         /* Nothing stale */
+    EXTI_IMR_BIT(line) = 1U;
+    NVIC_SetPriority(irqn, priority);
+    NVIC_EnableIRQ(irqn);
+}
+
+void exti_disable(uint8_t line) {
+    if (line >= EXTI_LINE_COUNT) return;
+
+    EXTI_IMR_BIT(line) = 0U;
+}
+
+void exti_set_oneshot(uint8_t line, bool oneshot) {
+    if (line >= EXTI_LINE_COUNT) return;
+
+    if (oneshot) oneshot_lines |= 1UL << line; else oneshot_lines &= ~(1UL << line);
+}
+
+void exti_handler(uint32_t lines) {
+    uint32_t pending = EXTI->PR & EXTI->IMR & lines;
+
+    if (pending == 0) return;
+
+    EXTI->PR = pending;     /* rc_w1: one write clears exactly these lines */
+
+    // One-shot lines stay quiet from this edge on, not from the callback
+    for (uint32_t mask = pending & oneshot_lines; mask; ) {
+        uint8_t line = (uint8_t)(31U - __CLZ(mask));
+
+        mask &= ~(1UL << line);
+        EXTI_IMR_BIT(line) = 0U;
+    }
+
+    lines_add(pending);
+    exti_post();
+}
+
+void exti_retry(void) {
+    if (deferred_lines != 0) {
+        exti_post();
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Vector of an EXTI line.
+  * @param  line: EXTI line (0-15).
+  * @retval IRQ number.
+  */
+static IRQn_Type exti_irqn(uint8_t line) {
+    if (line <= 4U) return (IRQn_Type)(EXTI0_IRQn + line);
+    if (line <= 9U) return EXTI9_5_IRQn;
+    return EXTI15_10_IRQn;
+}
+
+/**
+  * @brief  Queue the bottom half unless it is queued already.
+  * @note   If the queue is full the lines stay pending and PendSV is pended,
+  *         so exti_retry() posts again once the queue has drained; the next
+  *         dispatch retries too.
+  * @retval None
+  */
+static void exti_post(void) {
+    uint32_t queued;
+
+    do {
+        queued = __LDREXW(&bottom_half_queued);
+        if (queued) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(1U, &bottom_half_queued) != 0);
+
+    if (!deferred_post(exti_bottom_half, 0)) {
+        bottom_half_queued = 0;
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+}
+
+/**
+  * @brief  Run the callbacks of every line that fired (PendSV).
+  * @param  arg: Unused.
+  * @retval None
+  */
+static void exti_bottom_half(uint32_t arg) {
+    // Lines that fire from here on need a post of their own
+    bottom_half_queued = 0;
+    __DMB();
+
+    uint32_t pending = lines_take();
+
+    (void)arg;
+    while (pending) {
+        uint8_t line = (uint8_t)(31U - __CLZ(pending));
+
+        pending &= ~(1UL << line);
+        for (uint8_t i = callback_count[line]; i > 0; i--) {
+            callbacks[line][i - 1U](line);
+        }
+    }
+}
+
+/**
+  * @brief  Atomically add lines to the deferred mask.
+  * @param  lines: Lines that fired.
+  * @retval None
+  */
+static void lines_add(uint32_t lines) {
+    uint32_t old;
+
+    do {
+        old = __LDREXW(&deferred_lines);
+    } while (__STREXW(old | lines, &deferred_lines) != 0);
+}
+
+/**
+  * @brief  Atomically take and clear the deferred mask.
+  * @retval Lines that fired.
+  */
+static uint32_t lines_take(void) {
+    uint32_t old;
+
+    do {
+        old = __LDREXW(&deferred_lines);
+    } while (__STREXW(0, &deferred_lines) != 0);
+    return old;
+}
+
+/******************************** END OF FILE *********************************/
@@ -1,16 +1,87 @@
 /**
   ******************************************************************************
   * @file    interrupts.c
-  * @brief   Interrupt handler for button EXTI.
+  * @brief   Interrupt handlers forwarding to their drivers.
   ******************************************************************************
   */
 
 /* Includes ------------------------------------------------------------------*/
 #include "button.h"
+#include "button_capture.h"
+#include "button_oneshot.h"
+#include "board_config.h"
+#include "deferred.h"
+#include "exti.h"
+#include "led_bcm.h"
+#include "led_stream.h"
 
 /**
-  * @brief  EXTI0 interrupt handler (PA0 button).
+  * @brief  EXTI interrupt handlers; callbacks are registered per line.
   */
 void EXTI0_IRQHandler(void) {
-    button_exti_handler();
+    exti_handler(EXTI_LINES_0);
+}
+
+void EXTI1_IRQHandler(void) {
+    exti_handler(EXTI_LINES_1);
+}
+
+void EXTI2_IRQHandler(void) {
+    exti_handler(EXTI_LINES_2);
+}
+
+void EXTI3_IRQHandler(void) {
+    exti_handler(EXTI_LINES_3);
+}
+
+void EXTI4_IRQHandler(void) {
+    exti_handler(EXTI_LINES_4);
+}
+
+void EXTI9_5_IRQHandler(void) {
+    exti_handler(EXTI_LINES_9_5);
+}
+
+void EXTI15_10_IRQHandler(void) {
+    exti_handler(EXTI_LINES_15_10);
+}
+
+#if BUTTON_CAPTURE_ENABLED
+/**
+  * @brief  TIM5 interrupt handler (user button input capture).
+  */
+void TIM5_IRQHandler(void) {
+    button_capture_handler();
+}
+#endif
+
+#if BUTTON_ONESHOT_ENABLED
+/**
+  * @brief  TIM6 / DAC interrupt handler (user button settle timer).
+  */
+void TIM6_DAC_IRQHandler(void) {
+    button_oneshot_handler();
+}
+#endif
+
+/**
+  * @brief  DMA2 Stream1 interrupt handler (LED stream half/full transfer).
+  */
+void DMA2_Stream1_IRQHandler(void) {
+    led_stream_dma_handler();
+}
+
+/**
+  * @brief  TIM7 interrupt handler (LED BCM bit-plane timer).
+  */
+void TIM7_IRQHandler(void) {
+    led_bcm_timer_handler();
+}
+
+/**
+  * @brief  PendSV handler (deferred work, lowest priority).
+  */
+void PendSV_Handler(void) {
+    deferred_run();
+    exti_retry();
 }
@@ -7,6 +7,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "systick.h"
+#include "button.h"
 #include "stm32f4xx.h"
 
 /* Private typedef -----------------------------------------------------------*/
@@ -29,11 +30,13 @@ static volatile uint32_t systick_counter = 0;
 
 /**
   * @brief  SysTick interrupt handler.
-  * @note   Called every 1ms, increments systick_counter.
+  * @note   Called every 1ms, increments systick_counter and scans the
+  *         buttons.
   * @retval None
   */
 void SysTick_Handler(void) {
     systick_counter++;
+    button_tick();
 }
 
 /**
@@ -92,6 +95,17 @@ bool systick_delay_elapsed(uint32_t last_tick, uint32_t delay_ms) {
     return (systick_get_ticks() - last_tick) >= delay_ms;
 }
 
+/**
+  * @brief  Check if an absolute deadline has been reached (non-blocking).
+  * @param  deadline: Absolute tick, e.g. systick_get_ticks() + delay.
+  * @retval true once the current tick is at or past @p deadline.
+  * @note   Handles 32-bit counter overflow while the deadline is less than
+  *         2^31 ms away.
+  */
+bool systick_deadline_reached(uint32_t deadline) {
+    return !SYSTICK_BEFORE(systick_get_ticks(), deadline);
+}
+
 /**
   * @brief  Busy-wait delay (blocking).
   * @param  delay_ms: Delay duration in milliseconds.
@@ -26,12 +26,64 @@ typedef enum {
     LED_ALL = 0xFF  // Special value for all LEDs
 } led_id_t;
 
+/**
+  * @brief  LED drive polarity.
+  */
+typedef enum {
+    LED_ACTIVE_HIGH = 0,    /*!< Pin high = LED on */
+    LED_ACTIVE_LOW          /*!< Pin low = LED on (sinking LED) */
+} led_polarity_t;
+
+/**
+  * @brief  Static description of one LED output.
+  */
+typedef struct {
+    uint8_t port;           /*!< Index into LED_PORT_TABLE */
+    uint8_t pin;            /*!< Pin number 0..15 */
+    uint8_t polarity;       /*!< led_polarity_t */
+    uint8_t pwm_channel;    /*!< LED_PWM_TIMER channel 1..4, 0 = none */
+} led_desc_t;
+
+/**
+  * @brief  Button identifiers.
+  */
+typedef enum {
+    BUTTON_USER = 0,        // PA0
+    BUTTON_COUNT
+} button_id_t;
+
+/**
+  * @brief  Button input polarity.
+  */
+typedef enum {
+    BUTTON_ACTIVE_HIGH = 0, /*!< Pin high = pressed */
+    BUTTON_ACTIVE_LOW       /*!< Pin low = pressed (switch to ground) */
+} button_polarity_t;
+
+/**
+  * @brief  Static description of one button input.
+  */
+typedef struct {
+    uint8_t port;           /*!< Index into BUTTON_PORT_TABLE */
+    uint8_t pin;            /*!< Pin number 0..15 */
+    uint8_t polarity;       /*!< button_polarity_t */
+} button_desc_t;
+
+/**
+  * @brief  Gesture timing of one button.
+  */
+typedef struct {
+    uint16_t click_gap_ms;  /*!< Max release-to-press gap inside a click run */
+    uint16_t hold_ms;       /*!< Press length that counts as a hold */
+    uint16_t repeat_ms;     /*!< Auto-repeat period while held, 0 = off */
+    uint8_t max_clicks;     /*!< Longest click run (1 = single clicks only) */
+} button_profile_t;
+
 /* Exported constants --------------------------------------------------------*/
 
 
 // LED GPIO Configuration
-#define LED_GPIO_PORT        GPIOD
-
+// Enables the clock of every port listed in LED_PORT_TABLE
 #define LED_GPIO_CLK_ENABLE()  do {        \
     RCC->AHB1ENR |= RCC_AHB1ENR_GPIODEN;   \
 } while(0)
@@ -53,7 +105,75 @@ typedef enum {
 #define LED_BLUE_PIN_MSK    GPIO_PIN_15
 
 
-#define LED_ALL_PINS     (LED_GREEN_PIN_MSK | LED_ORANGE_PIN_MSK | LED_RED_PIN_MSK | LED_BLUE_PIN_MSK)
+// LED Descriptor Table
+// ===============================
+// One entry per led_id_t, indexed directly by the ID. Boards with more
+// LEDs extend led_id_t, list any extra GPIO ports in LED_PORT_TABLE and
+// add their clocks to LED_GPIO_CLK_ENABLE().
+// ===============================
+#define LED_PORT_COUNT      1
+#define LED_PORT_TABLE      { GPIOD }
+
+#define LED_DESCRIPTOR_TABLE {                                                  \
+    [LED_GREEN]  = { 0, LED_GREEN_PIN_NUM,  LED_ACTIVE_HIGH, 1 },  /* TIM4_CH1 */ \
+    [LED_ORANGE] = { 0, LED_ORANGE_PIN_NUM, LED_ACTIVE_HIGH, 2 },  /* TIM4_CH2 */ \
+    [LED_RED]    = { 0, LED_RED_PIN_NUM,    LED_ACTIVE_HIGH, 3 },  /* TIM4_CH3 */ \
+    [LED_BLUE]   = { 0, LED_BLUE_PIN_NUM,   LED_ACTIVE_HIGH, 4 },  /* TIM4_CH4 */ \
+}
+
+/* LED PWM Configuration -----------------------------------------------------*/
+// PD12..PD15 are TIM4 CH1..CH4 on alternate function 2
+#define LED_PWM_TIMER            TIM4
+#define LED_PWM_GPIO_AF          2U
+#define LED_PWM_RESOLUTION_BITS  10U    /*!< Duty resolution, 8..16 bits */
+#define LED_PWM_FREQ_HZ          1000U  /*!< Target PWM frequency */
+
+#define LED_PWM_TIMER_CLK_ENABLE() do {    \
+    RCC->APB1ENR |= RCC_APB1ENR_TIM4EN;    \
+} while(0)
+
+/* LED BCM Configuration -----------------------------------------------------*/
+// Binary code modulation gives 8-bit brightness to LEDs without a PWM
+// channel: one basic-timer interrupt per bit plane, 8 per frame
+#define LED_BCM_ENABLED          1
+#define LED_BCM_TIMER            TIM7
+#define LED_BCM_IRQN             TIM7_IRQn
+#define LED_BCM_TICK_HZ          1000000U  /*!< Timer tick (1 us) */
+#define LED_BCM_LSB_TICKS        16U       /*!< LSB slot, frame = 255 x LSB (~4 ms) */
+
+#define LED_BCM_TIMER_CLK_ENABLE() do {    \
+    RCC->APB1ENR |= RCC_APB1ENR_TIM7EN;    \
+} while(0)
+
+/* LED Stream (DMA) Configuration --------------------------------------------*/
+// GPIO sits on AHB1, which only DMA2 can reach; TIM8_UP is DMA2 Stream1 Ch7
+#define LED_STREAM_ENABLED       1      /*!< Play periodic patterns via DMA */
+#define LED_STREAM_PORT          0      /*!< Index into LED_PORT_TABLE */
+#define LED_STREAM_TIMER         TIM8
+#define LED_STREAM_DMA           DMA2
+#define LED_STREAM_DMA_STREAM    DMA2_Stream1
+#define LED_STREAM_DMA_CHANNEL   7U
+#define LED_STREAM_DMA_IRQN      DMA2_Stream1_IRQn
+#define LED_STREAM_BUFFER_WORDS  64U    /*!< Refill buffer, two halves */
+
+#define LED_STREAM_CLK_ENABLE() do {        \
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;     \
+    RCC->APB2ENR |= RCC_APB2ENR_TIM8EN;     \
+} while(0)
+
+/* Random Number Configuration -----------------------------------------------*/
+// Pattern randomness comes from a per-pattern PRNG. With RNG_HW_ENABLED each
+// pattern start is seeded from the on-chip RNG. The RNG runs from PLL48CLK,
+// which this 16 MHz HSI clock tree does not enable, so it is off by default
+// and PATTERN_RNG_SEED makes every run replay the same sequence.
+#define RNG_HW_ENABLED           0
+#define RNG_HW_TIMEOUT_POLLS     1000U     /*!< DRDY polls before giving up */
+#define PATTERN_RNG_SEED         0x2545F491UL
+
+/* Playlist Configuration ----------------------------------------------------*/
+// With PLAYLIST_AUTOSTART the board cycles through the playlist in main.c
+// unattended; a long press skips to the next entry.
+#define PLAYLIST_AUTOSTART       0
 
 /* Button Configuration ------------------------------------------------------*/
 #define BUTTON_GPIO_PORT         GPIOA       /*!< PA0 - User button */
@@ -65,6 +185,90 @@ typedef enum {
     RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN; \
 } while(0)
 
+// Buttons are debounced by whole-port scans: every port listed here is read
+// once per scan, whatever the number of buttons on it. More buttons extend
+// button_id_t, BUTTON_DESCRIPTOR_TABLE and BUTTON_GPIO_CLK_ENABLE().
+#define BUTTON_PORT_COUNT        1
+#define BUTTON_PORT_TABLE        { GPIOA }
+
+#define BUTTON_DESCRIPTOR_TABLE {                                   \
+    [BUTTON_USER] = { 0, BUTTON_GPIO_PIN_NUM, BUTTON_ACTIVE_HIGH },  \
+}
+
+// Scan period: a change must hold for 4 scans (vertical counter depth)
+#define BUTTON_SCAN_PERIOD_MS    ((DEBOUNCE_TIME_MS + 3U) / 4U)
+
+// Capture backend: PA0 is also TIM5_CH1. With BUTTON_CAPTURE_ENABLED the
+// user button leaves the scan and its edges are input-captured on TIM5, a
+// free-running 32-bit counter at 1 MHz, rising on CC1 and falling on CC2
+// (both from TI1). The input filter drops glitches in hardware; after each
+// edge the capture interrupts are held off for the lockout (CC3 compare),
+// so a bouncing contact costs two interrupts in total.
+#define BUTTON_CAPTURE_ENABLED   0
+#define BUTTON_CAPTURE_TIMER     TIM5
+#define BUTTON_CAPTURE_IRQN      TIM5_IRQn
+#define BUTTON_CAPTURE_GPIO_AF   2U        /*!< PA0 AF2 = TIM5_CH1 */
+#define BUTTON_CAPTURE_FILTER    0xFU      /*!< IC1F/IC2F: fDTS/32, N=8 (64 us at CKD=4) */
+#define BUTTON_CAPTURE_LOCKOUT_US (DEBOUNCE_TIME_MS * 1000U)
+
+#define BUTTON_CAPTURE_CLK_ENABLE() do {     \
+    RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;      \
+} while(0)
+
+// Adaptive lockout: the last edge captured during a lockout shows how long
+// the switch bounced. Its envelope (adopted at once when worse, decaying by
+// 1/2^SHIFT per edge when better) times the margin is the next lockout,
+// kept within MIN..MAX. Bounce that reaches the end of a lockout counts as
+// the whole lockout, so a worn switch doubles it until it fits. An edge
+// back within one lockout after it ended is bounce that spilled over: it
+// is learned and locked out again, not reported.
+#define BUTTON_CAPTURE_ADAPTIVE         1
+#define BUTTON_CAPTURE_LOCKOUT_MIN_US   2000U
+#define BUTTON_CAPTURE_LOCKOUT_MAX_US   BUTTON_CAPTURE_LOCKOUT_US
+#define BUTTON_CAPTURE_ADAPT_MARGIN_PCT 200U
+#define BUTTON_CAPTURE_ADAPT_SHIFT      3U
+
+// One-shot backend: the user button leaves the scan and is debounced by
+// EXTI0 alone. An edge masks the line and starts TIM6 for the settle time;
+// the timer interrupt samples PA0 once and unmasks the line. No polling
+// while idle. Choose at most one of the capture and one-shot backends.
+#define BUTTON_ONESHOT_ENABLED   0
+#define BUTTON_ONESHOT_TIMER     TIM6
+#define BUTTON_ONESHOT_IRQN      TIM6_DAC_IRQn
+#define BUTTON_ONESHOT_SETTLE_MS DEBOUNCE_TIME_MS
+
+#define BUTTON_ONESHOT_CLK_ENABLE() do {     \
+    RCC->APB1ENR |= RCC_APB1ENR_TIM6EN;      \
+} while(0)
+
+// Eager edges: EXTI0 queues a provisional press on the first edge, well
+// before debouncing ends. The debounced press confirms it; if none comes
+// within BUTTON_EAGER_CONFIRM_MS it is retracted. EXTI callbacks run from
+// PendSV, at SysTick priority, so they may feed the event ring too. The
+// capture backend reports its first edge at once and has no EXTI0, so
+// this applies to the scan and one-shot backends.
+#define BUTTON_EAGER_ENABLED     0
+#define BUTTON_EAGER_CONFIRM_MS  (DEBOUNCE_TIME_MS * 2U)
+
+#define BUTTON_EVENT_QUEUE_SIZE  16U         /*!< Queued events, power of two */
+
+// Gesture timing per button. The user button keeps the original behaviour:
+// double clicks, a 2 s long press and no auto-repeat.
+#define BUTTON_PROFILE_TABLE {                                                  \
+    [BUTTON_USER] = { DOUBLE_CLICK_MAX_MS, LONG_PRESS_TIME_MS, 0, 2 },          \
+}
+
+// Chords: sets of buttons that report BUTTON_EVENT_CHORD when held together,
+// e.g. { BUTTON_MASK(BUTTON_A) | BUTTON_MASK(BUTTON_B) }.
+#define BUTTON_CHORD_COUNT       0
+#define BUTTON_CHORD_TABLE       { 0 }
+
+/* EXTI Configuration --------------------------------------------------------*/
+#define EXTI_CALLBACKS_PER_LINE  2     /*!< e.g. a button and the sleep wake-up */
+
+/* Deferred Work Configuration -----------------------------------------------*/
+#define DEFERRED_QUEUE_SIZE      8U    /*!< Pending bottom halves, power of two */
+
 /* Timing Configuration ------------------------------------------------------*/
 #define DEBOUNCE_TIME_MS       50    /*!< Button de-bounce time */
 #define LONG_PRESS_TIME_MS     2000  /*!< 2 seconds for long press */
@@ -74,5 +278,10 @@ typedef enum {
 /* Interrupt Priorities ------------------------------------------------------*/
 #define EXTI_PRIORITY          0     /*!< Highest priority for button */
 #define SYSTICK_PRIORITY       1     /*!< Medium priority for systick */
+#define LED_STREAM_PRIORITY    2     /*!< DMA refill (half/full transfer) */
+#define LED_BCM_PRIORITY       1     /*!< BCM bit-plane timer, timing sensitive */
+#define BUTTON_CAPTURE_PRIORITY ((1UL << __NVIC_PRIO_BITS) - 1UL) /*!< As set by systick_init(): both feed the button event ring */
+#define BUTTON_ONESHOT_PRIORITY ((1UL << __NVIC_PRIO_BITS) - 1UL) /*!< Same: reports through button_edge() */
+#define DEFERRED_PRIORITY      ((1UL << __NVIC_PRIO_BITS) - 1UL) /*!< PendSV bottom halves, lowest */
 
 #endif
@@ -0,0 +1,408 @@
+/**
+  ******************************************************************************
+  * @file    patternc.c
+  * @brief   Host compiler from the pattern text language to keyframe images.
+  *
+  *          Parses a .pat file, unrolls its loops into the keyframe table the
+  *          firmware plays, writes it as a packed image (-o) and/or a C
+  *          table (-c), and runs the firmware's own pattern_engine.c over one
+  *          cycle to report timing and flash footprint.
+  *
+  *          Language (one statement per line, '#' starts a comment):
+  *            pattern <name>
+  *            frame <ms> <mask> [level N] [ramp] [random N] [jitter MS]
+  *            hold <mask> [level N]
+  *            loop <count>
+  *            end
+  *          <mask> is 0b..., 0x..., or LED names joined with '+'
+  *          (green, orange, red, blue, all, none).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pattern_engine.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_FRAMES          255U    /* pattern_program_t.frame_count is 8-bit */
+#define MAX_LOOP_DEPTH      8U
+#define MAX_NAME            48U
+#define MAX_TOKENS          16U
+#define MAX_SIM_UPDATES     1000000UL
+
+/* Private typedef -----------------------------------------------------------*/
+
+typedef struct {
+    char name[MAX_NAME];
+    pattern_keyframe_t frames[MAX_FRAMES];
+    uint32_t frame_count;
+    bool holds;                     /* Last frame is a hold */
+} pattern_source_t;
+
+typedef struct {
+    uint32_t first_frame;           /* Loop body starts here */
+    uint32_t count;                 /* Total iterations */
+    unsigned line;                  /* Line of the 'loop' statement */
+} loop_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const char *input_path = "";
+static unsigned input_line = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void fail(const char *fmt, ...);
+static uint32_t parse_number(const char *text, uint32_t max, const char *what);
+static uint8_t parse_mask(const char *text);
+static void parse_frame(pattern_source_t *src, char **tok, unsigned count, bool hold);
+static void parse_file(FILE *in, pattern_source_t *src);
+static void write_image(const pattern_source_t *src, const char *path);
+static void write_table(const pattern_source_t *src, const char *path);
+static void report(const pattern_source_t *src, uint32_t seed);
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(int argc, char **argv) {
+    const char *image_path = 0;
+    const char *table_path = 0;
+    uint32_t seed = 1;
+    int arg;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            image_path = argv[++arg];
+        } else if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc) {
+            table_path = argv[++arg];
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++arg], 0, 0);
+        } else {
+            break;
+        }
+    }
+
+    if (arg != argc - 1) {
+        fprintf(stderr, "usage: patternc [-o image.bin] [-c table.h] [-s seed] input.pat\n");
+        return 2;
+    }
+
+    input_path = argv[arg];
+    FILE *in = fopen(input_path, "r");
+    if (in == 0) {
+        fprintf(stderr, "%s: %s\n", input_path, strerror(errno));
+        return 1;
+    }
+
+    static pattern_source_t src;
+    parse_file(in, &src);
+    fclose(in);
+
+    if (image_path) write_image(&src, image_path);
+    if (table_path) write_table(&src, table_path);
+
+    report(&src, seed);
+    return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static void fail(const char *fmt, ...) {
+    va_list args;
+
+    fprintf(stderr, "%s:%u: error: ", input_path, input_line);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+static uint32_t parse_number(const char *text, uint32_t max, const char *what) {
+    char *end;
+    unsigned long value = strtoul(text, &end, 0);
+
+    if (*text == '\0' || *end != '\0' || value > max) {
+        fail("%s '%s' is not a number in 0..%lu", what, text, (unsigned long)max);
+    }
+    return (uint32_t)value;
+}
+
+static uint8_t parse_mask(const char *text) {
+    static const struct { const char *name; uint8_t mask; } names[] = {
+        { "green", 0x01 }, { "orange", 0x02 }, { "red", 0x04 }, { "blue", 0x08 },
+        { "all", 0x0F }, { "none", 0x00 },
+    };
+
+    if (strncmp(text, "0b", 2) == 0) {
+        uint32_t mask = 0;
+        const char *digit = text + 2;
+
+        if (*digit == '\0') fail("empty mask '%s'", text);
+        for (; *digit; digit++) {
+            if (*digit != '0' && *digit != '1') fail("bad binary mask '%s'", text);
+            mask = (mask << 1) | (uint32_t)(*digit - '0');
+            if (mask > 0xFFU) fail("mask '%s' wider than 8 LEDs", text);
+        }
+        return (uint8_t)mask;
+    }
+
+    if (isdigit((unsigned char)text[0])) {
+        return (uint8_t)parse_number(text, 0xFFU, "mask");
+    }
+
+    // LED names joined with '+'
+    uint8_t mask = 0;
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+
+    for (char *name = strtok(buffer, "+"); name; name = strtok(0, "+")) {
+        size_t i;
+
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strcmp(name, names[i].name) == 0) break;
+        }
+        if (i == sizeof(names) / sizeof(names[0])) fail("unknown LED '%s'", name);
+        mask |= names[i].mask;
+    }
+    return mask;
+}
+
+static void parse_frame(pattern_source_t *src, char **tok, unsigned count, bool hold) {
+    pattern_keyframe_t kf = { 0, 0, PATTERN_LEVEL_FULL, 0, 0 };
+    unsigned i = 1;
+
+    if (src->holds) fail("frames after a hold are never reached");
+    if (src->frame_count >= MAX_FRAMES) fail("more than %u keyframes", MAX_FRAMES);
+
+    if (!hold) {
+        if (count < 3) fail("usage: frame <ms> <mask> [options]");
+        kf.duration_ms = (uint16_t)parse_number(tok[i++], 0xFFFFU, "duration");
+        if (kf.duration_ms == 0) fail("frame duration must be > 0 (use 'hold')");
+    } else if (count < 2) {
+        fail("usage: hold <mask> [level N]");
+    }
+    kf.mask = parse_mask(tok[i++]);
+
+    while (i < count) {
+        const char *option = tok[i++];
+
+        if (strcmp(option, "ramp") == 0 && !hold) {
+            kf.flags |= PATTERN_KF_RAMP;
+            continue;
+        }
+        if (i >= count) fail("option '%s' needs a value", option);
+
+        if (strcmp(option, "level") == 0) {
+            kf.level = (uint8_t)parse_number(tok[i++], 255U, "level");
+        } else if (strcmp(option, "random") == 0 && !hold) {
+            uint32_t pick = parse_number(tok[i++], 15U, "random pick");
+            if (pick == 0) fail("random pick must be 1..15");
+            kf.flags |= PATTERN_KF_RANDOM | PATTERN_KF_PICK(pick);
+        } else if (strcmp(option, "jitter") == 0 && !hold) {
+            uint32_t jitter = parse_number(tok[i++], 255U * PATTERN_JITTER_UNIT_MS, "jitter");
+            if (jitter % PATTERN_JITTER_UNIT_MS) fail("jitter must be a multiple of %u ms", PATTERN_JITTER_UNIT_MS);
+            kf.jitter = (uint8_t)(jitter / PATTERN_JITTER_UNIT_MS);
+        } else {
+            fail("unknown option '%s'", option);
+        }
+    }
+
+    if (kf.jitter && !(kf.flags & PATTERN_KF_RANDOM)) fail("jitter needs 'random'");
+
+    src->frames[src->frame_count++] = kf;
+    src->holds = hold;
+}
+
+static void parse_file(FILE *in, pattern_source_t *src) {
+    loop_t loops[MAX_LOOP_DEPTH];
+    unsigned depth = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), in)) {
+        char *tok[MAX_TOKENS];
+        unsigned count = 0;
+
+        input_line++;
+        line[strcspn(line, "#\r\n")] = '\0';
+
+        for (char *t = strtok(line, " \t"); t; t = strtok(0, " \t")) {
+            if (count == MAX_TOKENS) fail("too many words");
+            tok[count++] = t;
+        }
+        if (count == 0) continue;
+
+        if (strcmp(tok[0], "pattern") == 0) {
+            if (count != 2) fail("usage: pattern <name>");
+            if (src->name[0]) fail("one pattern per file");
+            for (const char *c = tok[1]; *c; c++) {
+                if (!isalnum((unsigned char)*c) && *c != '_') fail("name must be a C identifier");
+            }
+            snprintf(src->name, sizeof(src->name), "%s", tok[1]);
+        } else if (strcmp(tok[0], "frame") == 0) {
+            parse_frame(src, tok, count, false);
+        } else if (strcmp(tok[0], "hold") == 0) {
+            parse_frame(src, tok, count, true);
+        } else if (strcmp(tok[0], "loop") == 0) {
+            if (count != 2) fail("usage: loop <count>");
+            if (depth == MAX_LOOP_DEPTH) fail("loops nested deeper than %u", MAX_LOOP_DEPTH);
+            loops[depth].first_frame = src->frame_count;
+            loops[depth].count = parse_number(tok[1], MAX_FRAMES, "loop count");
+            loops[depth].line = input_line;
+            if (loops[depth].count == 0) fail("loop count must be > 0");
+            depth++;
+        } else if (strcmp(tok[0], "end") == 0) {
+            if (depth == 0) fail("'end' without 'loop'");
+            const loop_t *loop = &loops[--depth];
+            uint32_t body = src->frame_count - loop->first_frame;
+
+            if (body == 0) fail("empty loop");
+            if (src->holds) fail("'hold' inside a loop");
+            if (src->frame_count + body * (loop->count - 1U) > MAX_FRAMES) {
+                fail("loop expands past %u keyframes", MAX_FRAMES);
+            }
+            for (uint32_t n = 1; n < loop->count; n++) {
+                memcpy(&src->frames[src->frame_count], &src->frames[loop->first_frame],
+                       body * sizeof(pattern_keyframe_t));
+                src->frame_count += body;
+            }
+        } else {
+            fail("unknown statement '%s'", tok[0]);
+        }
+    }
+
+    if (depth != 0) {
+        input_line = loops[depth - 1].line;
+        fail("'loop' without 'end'");
+    }
+    if (src->frame_count == 0) fail("no frames");
+    if (src->name[0] == '\0') snprintf(src->name, sizeof(src->name), "pattern");
+}
+
+static void put_u16(FILE *out, uint32_t value) {
+    fputc((int)(value & 0xFFU), out);
+    fputc((int)((value >> 8) & 0xFFU), out);
+}
+
+static void write_image(const pattern_source_t *src, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    // Little-endian, laid out exactly like pattern_blob_header_t + keyframes
+    put_u16(out, PATTERN_BLOB_MAGIC & 0xFFFFU);
+    put_u16(out, PATTERN_BLOB_MAGIC >> 16);
+    fputc(PATTERN_BLOB_VERSION, out);
+    fputc((int)src->frame_count, out);
+    put_u16(out, 0);
+
+    for (uint32_t i = 0; i < src->frame_count; i++) {
+        const pattern_keyframe_t *kf = &src->frames[i];
+
+        put_u16(out, kf->duration_ms);
+        fputc(kf->mask, out);
+        fputc(kf->level, out);
+        fputc(kf->flags, out);
+        fputc(kf->jitter, out);
+    }
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        exit(1);
+    }
+}
+
+static void write_table(const pattern_source_t *src, const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    fprintf(out, "/* Generated by patternc from %s - do not edit */\n", input_path);
+    fprintf(out, "static const pattern_keyframe_t %s_frames[] = {\n", src->name);
+    for (uint32_t i = 0; i < src->frame_count; i++) {
+        const pattern_keyframe_t *kf = &src->frames[i];
+
+        fprintf(out, "    { %5u, 0x%02X, %3u, 0x%02X, %3u },\n",
+                kf->duration_ms, kf->mask, kf->level, kf->flags, kf->jitter);
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        exit(1);
+    }
+}
+
+static void report(const pattern_source_t *src, uint32_t seed) {
+    const pattern_program_t program = { src->frames, (uint8_t)src->frame_count };
+    uint32_t nominal_ms = 0;
+    uint32_t jitter_ms = 0;
+
+    printf("pattern %s: %u keyframes, %u bytes flash (%u header + %u x %u)\n",
+           src->name, (unsigned)src->frame_count,
+           (unsigned)(sizeof(pattern_blob_header_t) + src->frame_count * sizeof(pattern_keyframe_t)),
+           (unsigned)sizeof(pattern_blob_header_t), (unsigned)src->frame_count,
+           (unsigned)sizeof(pattern_keyframe_t));
+
+    printf("  #    start      ms  mask  level  flags\n");
+    for (uint32_t i = 0; i < src->frame_count; i++) {
+        const pattern_keyframe_t *kf = &src->frames[i];
+        uint32_t extra = kf->jitter ? kf->jitter * PATTERN_JITTER_UNIT_MS - 1U : 0;
+
+        printf("  %-3u %6u  %6u  0x%02X  %5u  %s%s%s",
+               (unsigned)i, (unsigned)nominal_ms, kf->duration_ms, kf->mask, kf->level,
+               (kf->flags & PATTERN_KF_RAMP) ? "ramp " : "",
+               (kf->flags & PATTERN_KF_RANDOM) ? "random " : "",
+               kf->duration_ms == 0 ? "hold" : "");
+        if (extra) printf("(+0..%u ms)", (unsigned)extra);
+        printf("\n");
+
+        nominal_ms += kf->duration_ms;
+        jitter_ms += extra;
+    }
+
+    if (src->holds) {
+        printf("  cycle: one-shot, holds after %u ms\n", (unsigned)nominal_ms);
+    } else if (jitter_ms) {
+        printf("  cycle: %u..%u ms\n", (unsigned)nominal_ms, (unsigned)(nominal_ms + jitter_ms));
+    } else {
+        printf("  cycle: %u ms\n", (unsigned)nominal_ms);
+    }
+    printf("  dma-streamable: %s\n", pattern_program_is_streamable(&program) ? "yes" : "no");
+
+    // One cycle through the firmware interpreter, jumping deadline to deadline
+    pattern_player_t player = {0};
+    uint32_t now = 0;
+    uint32_t deadline;
+    unsigned long updates = 0;
+    unsigned long changes = 0;
+    uint32_t entered = 0;
+
+    pattern_player_seed(&player, seed);
+    pattern_player_set_speed(&player, PATTERN_SPEED_NORMAL, now);   // Authored timing
+    pattern_player_start(&player, &program, now);
+    uint32_t frame_start = player.frame_start_ms;
+
+    while (updates < MAX_SIM_UPDATES) {
+        if (pattern_player_update(&player, now)) changes++;
+        updates++;
+
+        if (player.frame_start_ms != frame_start) {
+            frame_start = player.frame_start_ms;
+            if (++entered == src->frame_count) break;   // Back at frame 0
+        }
+        if (!pattern_player_next_deadline(&player, &deadline)) break;
+        now = deadline;
+    }
+
+    printf("  simulated: %lu updates, %lu output changes over %u ms\n",
+           updates, changes, (unsigned)now);
+}
+
+/******************************** END OF FILE *********************************/